@@ -61,6 +61,7 @@ typedef unsigned char         macaddr_6_t[MAC_BYTEADDR_SIZE];
 #define ml_lport_index   0x22
 #define ml_rx_pdu_index  0x33
 #define ml_cfgMgr_index  0x44
+#define ml_sync_index    0x55
 
 /******************************************************************************************/
 /**                             ML_event & related                                       **/
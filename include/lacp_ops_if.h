@@ -72,7 +72,8 @@
  *      exit
  *      list-commands
  *      version
- *      lacpd/dump [{interface [interface name]} | {port [port name]}]
+ *      lacpd/dump [{interface [interface name]} | {port [port name]} |
+ *                  {lag_id [LAG ID]}]
  *      vlog/disable-rate-limit [module]...
  *      vlog/enable-rate-limit  [module]...
  *      vlog/list
@@ -126,6 +127,15 @@ struct lacp_status_values {
     char *state;
 };
 
+/* Binary form of the values in struct lacp_status_values. */
+struct lacp_status_raw {
+    system_variables_t  system_id;
+    u_short             port_priority;
+    u_short             port_number;
+    u_short             key;
+    state_parameters_t  state;
+};
+
 /*************************************************************************//**
  * @ingroup lacpd_ovsdb_if
  * @brief lacpd's internal data strucuture to store per interface data.
@@ -139,6 +149,10 @@ struct iface_data {
                                               to become member of configured LAG */
     enum ovsrec_interface_link_state_e link_state; /*!< operational link state */
     enum ovsrec_interface_duplex_e duplex;  /*!< operational link duplex */
+    bool                hw_bond_rx_enabled; /*!< rx_enabled last written to hw_bond_config */
+    bool                hw_bond_tx_enabled; /*!< tx_enabled last written to hw_bond_config */
+    const char          *bond_status_key;   /*!< bond_status key last written, or NULL */
+    bool                rewrite;            /*!< A write failed, write again what lacpd owns */
 
     /* These members are valid only within lacpd_reconfigure(). */
     const struct ovsrec_interface *cfg;     /*!< pointer to corresponding row in IDL cache */
@@ -162,10 +176,19 @@ struct iface_data {
     /* LACPDU send/receive related. */
     int                 pdu_sockfd;         /*!< Socket FD for LACPDU rx/tx */
     bool                pdu_registered;     /*!< Indicates if port is registered to receive LACPDU */
+    int                 proto_shard;        /*!< Protocol shard running the port, -1 if none; atomic, read by the RX thread */
+    bool                move_pending;       /*!< Moving to another shard, waiting for the old one */
+    unsigned int        move_seq;           /*!< Sequence number of the pending move */
+    int                 move_shard;         /*!< Shard the held messages go to */
+    struct ML_event     **held_events;      /*!< Messages held while move_pending */
+    size_t              n_held_events;
+    size_t              held_events_allocated;
 
     /* LACP status values formatted */
     struct lacp_status_values actor;        /*!< Currently set lacp status values - actor */
     struct lacp_status_values partner;      /*!< Currently set lacp status values - partner */
+    struct lacp_status_raw    actor_raw;    /*!< Values the actor strings were formatted from */
+    struct lacp_status_raw    partner_raw;  /*!< Values the partner strings were formatted from */
     bool                      lacp_current; /*!< Currently set lacp_current value */
     bool                      lacp_current_set; /*!< false=lacp_current is not set, true=lacp_current is set */
     struct state_parameters   local_state;
@@ -190,6 +213,19 @@ extern void db_delete_lag_port(uint16_t lag_id, int port, lacp_per_port_variable
 
 extern void db_update_interface(lacp_per_port_variables_t *plpinfo);
 
+// Groups the updates posted in between into one OVSDB transaction
+extern void lacpd_delta_hold(void);
+extern void lacpd_delta_release(void);
+
+// Tells the OVS thread a shard has answered ml_sync_shard()
+extern void lacpd_shard_synced(int port, unsigned int seq);
+
+// Asks the OVS thread to resend the link state it has from OVSDB
+extern void lacpd_link_state_resync(int port);
+
+// Asks the OVS thread to turn off TX in h/w for a member that lost its link
+extern void lacpd_fast_tx_disable(const char *name, int port);
+
 // Utility functions
 extern struct iface_data *find_iface_data_by_index(int index);
 
@@ -210,6 +246,16 @@ extern void lacpd_ovsdb_if_init(const char *db_path);
  *****************************************************************************/
 extern void lacpd_ovsdb_if_exit(void);
 
+/**************************************************************************//**
+ * Sets how often, in milliseconds, LACP status changes reported by the
+ * protocol thread are written to OVSDB.  Changes within one interval
+ * are coalesced into a single transaction.
+ *
+ * @param[in] interval is the minimum time between status transactions.
+ *
+ *****************************************************************************/
+extern void lacpd_set_status_interval(int interval);
+
 /**************************************************************************//**
  * Setup file descriptors for IDL's poll function.
  * Called by lacpd's main loop to setup daemon specific wait criterion for
@@ -275,11 +321,21 @@ extern void lacpd_state_dump(struct ds *ds, int argc, const char *argv[]);
 /**************************************************************************//**
  * lacpd daemon's main OVS interface function.
  *
- * @param arg pointer to ovs-appctl server struct.
+ * @param arg unused.
  *
  *****************************************************************************/
 extern void *lacpd_ovs_main_thread(void *arg);
 
+/**************************************************************************//**
+ * lacpd daemon's ovs-appctl server function.  The dump commands read
+ * the views published by the OVS interface thread and the port
+ * snapshots published by the protocol threads.
+ *
+ * @param arg pointer to ovs-appctl server struct.
+ *
+ *****************************************************************************/
+extern void *lacpd_appctl_thread(void *arg);
+
 /** @} end of group lacpd_ovsdb_if */
 
 #endif /* __LACP_OPS_IF__H__ */
@@ -60,6 +60,24 @@
 
 #define NO_SYSTEM_ID "0,00:00:00:00:00:00"
 
+/*****************************************************************************
+ *      PORT SNAPSHOTS
+ *
+ * What the appctl dumps show of a port, as last published by the
+ * protocol shard running it.
+ *****************************************************************************/
+typedef struct lacp_port_snapshot {
+    bool valid;
+    int shard;
+    state_parameters_t actor_oper_port_state;
+    state_parameters_t partner_oper_port_state;
+    lacp_control_variables_t lacp_control;
+    u_int lacp_pdus_sent;
+    u_int marker_response_pdus_sent;
+    u_int lacp_pdus_received;
+    u_int marker_pdus_received;
+} lacp_port_snapshot_t;
+
 /*****************************************************************************/
 /*                   Prototypes for Global routines                          */
 /*****************************************************************************/
@@ -88,6 +106,13 @@ extern void LACP_update_port_params(port_handle_t lport_handle,
                                     short data, int hw_collecting);
 extern int port_number_2_link_group_index(int);
 extern void LAG_selection(lacp_per_port_variables_t *);
+extern void LAG_add_member(LAG_t *, lacp_per_port_variables_t *);
+extern void LAG_remove_member(LAG_t *, lacp_per_port_variables_t *);
+extern void LAG_delete(LAG_t *);
+extern void LAG_pool_init(void);
+extern void LAG_pool_stats(int, int *, int *, int *);
+extern void LACP_set_sport_handle(lacp_per_port_variables_t *, port_handle_t);
+extern void LACP_update_sport_priority(lacp_per_port_variables_t *);
 extern void LAG_id_string(char *const, LAG_Id_t *const);
 extern int loop_back_check(lacp_per_port_variables_t *);
 extern void print_lacp_fsm_state(port_handle_t);
@@ -109,19 +134,40 @@ extern void set_all_port_system_priority(void);
 extern void set_lport_fallback_status(port_handle_t, int);
 extern void set_all_port_system_mac_addr(void);
 extern void set_lport_overrides(port_handle_t, int, unsigned char *);
+extern lacp_per_port_variables_t *LACP_find_port(port_handle_t);
+extern void LACP_publish_port(lacp_per_port_variables_t *);
+extern void LACP_publish_port_lag(port_handle_t);
+extern void LACP_publish_all_ports(void);
+extern bool LACP_read_port_snapshot(int, lacp_port_snapshot_t *);
+extern void LACP_effects_begin(void);
+extern void LACP_effects_apply(int *, int *);
+extern void LACP_effects_pdu_received(port_handle_t);
+extern void LACP_effect_status(lacp_per_port_variables_t *);
+extern void LACP_effect_attach(lacp_per_port_variables_t *, int);
+extern void LACP_effect_egress_enable(lacp_per_port_variables_t *);
+extern void LACP_effect_detach(lacp_per_port_variables_t *);
 
 extern void lacp_support_diag_dump(int port);
 
 /*****************************************************************************
  *       Extern declarations for global variables
  *****************************************************************************/
-extern unsigned char my_mac_addr[];
-extern uint actor_system_priority;
-extern lacp_avl_tree_t lacp_per_port_vars_tree;
+extern __thread unsigned char my_mac_addr[];
+extern __thread uint actor_system_priority;
+extern __thread lacp_avl_tree_t lacp_per_port_vars_tree;
+extern __thread lacp_per_port_variables_t *lacp_port_table[];
+extern __thread int lacp_port_count;
 extern const unsigned char lacp_mcast_addr[];
 extern const unsigned char default_partner_system_mac[];
 extern int lacp_tables_last_changed_time;
 extern LAG_t *lacp_lags[];
 extern unsigned int lacp_cli_opt_mask[];
 
+/* Walks every port with LACP enabled, in no particular order.  LACP
+ * must not be enabled or disabled on any port from the loop body. */
+#define LACP_FOR_EACH_PORT(PLP, I)                                  \
+    for ((I) = 0;                                                   \
+         (I) < lacp_port_count && ((PLP) = lacp_port_table[(I)]);   \
+         (I)++)
+
 #endif  /* _LACP_SUPPORT_H_ */
@@ -22,7 +22,7 @@
 //***************************************************************
 // Variables in lacpd.c
 //***************************************************************
-extern bool exiting;
+extern bool exiting;     // Use __atomic loads and stores
 
 //***************************************************************
 // Functions in mlacp_main.c
@@ -31,8 +31,67 @@ extern void *mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)));
 extern void register_mcast_addr(port_handle_t lport_handle);
 extern void deregister_mcast_addr(port_handle_t lport_handle);
 extern int mlacp_tx_pdu(unsigned char* data, int length, port_handle_t lport_handle);
-extern void *lacpd_protocol_thread(void *arg  __attribute__ ((unused)));
+extern void *lacpd_protocol_thread(void *arg);
 extern int mlacp_init(u_long);
+extern unsigned long long ml_shard_n_events(int shard);
+
+// Protocol event handling times.  Histogram bucket 0 counts events
+// handled in under 1 us, bucket N those that took [2^(N-1), 2^N) us and
+// the last bucket everything slower.
+#define ML_STALL_BUCKETS            21
+#define ML_STALL_WORST              8
+#define ML_STALL_THRESHOLD_DEFAULT  100     // ms
+
+typedef struct ml_stall {
+    long long   duration;       // Handling time, us
+    long long   when;           // Wall clock time it finished, ms
+    int         peer;           // ml_*_index of the sender
+    int         msgnum;
+    int         port;           // Port the event was about, or -1
+    int         lag_id;         // LAG the event was about, or -1
+} ml_stall_t;
+
+typedef struct ml_stall_stats {
+    unsigned long long  hist[ML_STALL_BUCKETS];
+    int                 n_worst;
+    ml_stall_t          worst[ML_STALL_WORST];  // Slowest first
+} ml_stall_stats_t;
+
+extern void ml_set_stall_threshold(int msec);
+extern int ml_stall_threshold(void);
+extern void ml_shard_stall_stats(int shard, ml_stall_stats_t *stats);
+extern const char *ml_event_name(int peer, int msgnum);
+
+// Side effects of received LACPDUs: the h/w and lacp_status updates the
+// state machines asked for, and those sent to the OVS thread once each
+// LACPDU had been handled.
+//
+// LAG bring-ups are timed from the first LACPDU a member received while
+// not distributing, to when egress is enabled on all members.
+typedef struct ml_effects_stats {
+    unsigned long long  n_pdus;             // LACPDUs handled
+    unsigned long long  n_requested;        // Updates asked for
+    unsigned long long  n_applied;          // Updates sent
+    unsigned long long  n_bringups;         // LAGs that reached all members
+    long long           last_bringup;       // ms
+    long long           max_bringup;        // ms
+} ml_effects_stats_t;
+
+extern void ml_shard_effects_stats(int shard, ml_effects_stats_t *stats);
+extern void ml_record_lag_bringup(long long msec);
+
+// Kernel link state watch.
+typedef struct ml_link_watch_stats {
+    bool                enabled;
+    int                 n_watched;          // Interfaces watched
+    unsigned long long  n_events;           // rtnetlink link messages
+    unsigned long long  n_fast_down;        // Link downs sent ahead of OVSDB
+    unsigned long long  n_resync;           // Link state resyncs from OVSDB
+} ml_link_watch_stats_t;
+
+extern void ml_enable_link_watch(void);
+extern void ml_link_watch_get_stats(ml_link_watch_stats_t *stats);
+extern void ml_link_watch_remove(int port);
 
 //***************************************************************
 // Functions in mlacp_send.c
@@ -59,7 +118,6 @@ extern void mlacp_process_rxPdu(port_handle_t sport_handle, unsigned char *data)
 //***************************************************************
 extern void LACP_periodic_tx(void);
 extern void LACP_current_while_expiry(void);
-extern int lacp_lag_port_match(void *v1, void *v2);
 extern void LACP_process_input_pkt(port_handle_t lport_handle, unsigned char * data, int len);
 
 //***************************************************************
@@ -18,6 +18,7 @@
 #define __MQUEUE_H__
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <search.h>
 #include <semaphore.h>
 
@@ -36,6 +37,12 @@ typedef struct mqueue {
 
 extern int mqueue_init(mqueue_t *queue);
 extern int mqueue_send(mqueue_t *queue, void *data);
+extern int mqueue_send_urgent(mqueue_t *queue, void *data);
+extern int mqueue_send_urgent_superseding(mqueue_t *queue, void *data,
+                                          bool (*supersedes)(const void *data,
+                                                             const void *queued),
+                                          void (*drop)(void *queued));
 extern int mqueue_wait(mqueue_t *queue, void **data);
+extern int mqueue_trywait(mqueue_t *queue, void **data);
 
 #endif  /*  __MQUEUE_H__  */
@@ -184,6 +184,12 @@ typedef struct lacp_sport_params_s {
 typedef struct lacp_int_sport_params_s {
     lacp_sport_params_t  lacp_params;   /* Should be the first field in this struct */
     void                *psport;        /* Pointer to the super port */
+
+    /* Aggregator match index (see mvlan_lacp.c), -1 if not hashed. */
+    struct lacp_int_sport_params_s *key_next;     /* Same port type & actor key */
+    struct lacp_int_sport_params_s *partner_next; /* ... and same partner key */
+    int                  key_bucket;
+    int                  partner_bucket;
 } lacp_int_sport_params_t;
 
 
@@ -193,6 +199,7 @@ extern int mvlan_api_validate_unset_sport_params(struct MLt_vpm_api__lacp_sport_
 extern int mvlan_api_validate_set_sport_params(struct MLt_vpm_api__lacp_sport_params *placp_params);
 extern int mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params);
 extern int mvlan_unset_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params);
+extern void mvlan_sport_params_unhash(lacp_int_sport_params_t *placp_sport_params);
 
 // Called to clear out LAG information when all ports are really detached.
 // This essentially clears the LAG and put it back to the "free" pool
@@ -202,8 +209,22 @@ extern int mvlan_api_select_aggregator(struct MLt_vpm_api__lacp_match_params *pl
 extern int mvlan_api_attach_lport_to_aggregator(struct MLt_vpm_api__lacp_attach *placp_attach_params);
 extern int mvlan_api_detach_lport_from_aggregator(struct MLt_vpm_api__lacp_attach *placp_detach_params);
 
-extern int ml_send_event(ML_event* event);
+// Protocol shards.  Each shard is a protocol thread with its own event
+// queue, timer ticks and LACP state (ports, LAGs and super ports); a LAG
+// and all of its member ports are always run by the same shard.
+#define ML_MAX_SHARDS   16
+
+extern int ml_n_shards;
+extern __thread int ml_shard_id;
+
+extern int ml_set_n_shards(int n_shards);
+extern int ml_lag_shard(int lag_id);
+extern int ml_send_event(int shard, ML_event* event);
+extern int ml_send_urgent_event(int shard, ML_event* event);
+extern int ml_broadcast_event(ML_event* event, int size);
+extern int ml_sync_shard(int shard, int port, unsigned int seq);
 extern ML_event* ml_wait_for_next_event(void);
+extern ML_event* ml_poll_next_event(void);
 extern void ml_event_free(ML_event* event);
 
 // LACPDU send function
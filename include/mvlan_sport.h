@@ -40,6 +40,8 @@
 
 typedef struct super_port_s super_port_t;
 
+struct lacp_per_port_variables;
+
 /*********************************************************************
  * Structure defining the super-port information maintained by vpm
  * in the user-space.
@@ -72,11 +74,18 @@ struct super_port_s
                                         * oper_state_bits and stp_state_1vst
                                         * (the last for bridged traffic only).
                                         */
-   int     num_lports;                  /* Number of lports in this list */
-   void    *plport_list;                /* Logical Port Handle List: A list of
-                                           ports that are supported. A linklist
-                                           of the handles of all the logical
-                                           ports that this SmartTrunk contains. */
+   int     num_lports;                  /* Number of lports attached */
+   struct lacp_per_port_variables *plport_list;
+                                        /* Logical Port List: the lports whose
+                                           sport_handle is this SmartTrunk,
+                                           sorted by lport_handle.  Kept by
+                                           LACP_set_sport_handle(). */
+   struct lacp_per_port_variables *pprio_list;
+                                        /* The lports above whose receive
+                                           machine is not DEFAULTED, sorted by
+                                           actor_oper_port_priority, so the
+                                           head has the max port priority.
+                                           Kept by LACP_update_sport_priority(). */
 
    void   *placp_params;                /* pointer to the the superport parameters
                                             as defined in mvlan_lacp.h */
@@ -84,6 +93,17 @@ struct super_port_s
    int     aggr_mode;                   /* Mac, l3, l4 or port based */
 };
 
+/* Walk the lports of a super port.  Use the _SAFE version if PLP may
+ * leave the list while walking. */
+#define SPORT_FOR_EACH_LPORT(PLP, PSPORT) \
+    for ((PLP) = (PSPORT)->plport_list; (PLP) != NULL; \
+         (PLP) = (PLP)->sport_member.next)
+
+#define SPORT_FOR_EACH_LPORT_SAFE(PLP, NEXT, PSPORT) \
+    for ((PLP) = (PSPORT)->plport_list; \
+         (PLP) != NULL && (((NEXT) = (PLP)->sport_member.next), 1); \
+         (PLP) = (NEXT))
+
 extern int mvlan_sport_init(u_long  first_time);
 extern int mvlan_sport_create(struct MLt_vpm_api__create_sport  *psport_create,
                               super_port_t **ppsport);
@@ -73,23 +73,35 @@ typedef unsigned long long port_handle_t;
 /* +-----------------------------------------------------------------------+ */
 /* |TYPE | slot |module| port | lport |svlan|Reserv| lamda| cha_ | vpi| vci| */
 /* |     |      |      |      | type  |     |ed    |      | nnel |    |    | */
-/* |1 (0)|  5   |  2   |  8   |  4    |1 (0)|  6   |   5  |  8   |  8 | 16 | */
+/* |1 (0)|  5   |  2   |  12  |  4    |1 (0)|  2   |   5  |  8   |  8 | 16 | */
 /* +-----------------------------------------------------------------------+ */
 /* Stacked Vlan Port Handle                                                  */
 /* +-----------------------------------------------------------------------+ */
 /* |TYPE | slot |module| port | lport |svlan| Reserved    | vlan           | */
 /* |     |      |      |      | type  |     |             |                | */
-/* |1 (0)|  5   |  2   |  8   |  4    |1 (1)|    31       |  12            | */
+/* |1 (0)|  5   |  2   |  12  |  4    |1 (1)|    27       |  12            | */
 /* +-----------------------------------------------------------------------+ */
 
+#define PM_SLOT_OFFSET          58
+#define PM_MODULE_OFFSET        56
+#define PM_PORT_OFFSET          44
+#define PM_PORT_MASK            0xFFF
+#define PM_LPORT_TYPE_OFFSET    40
+
+/* Number of port numbers a physical port handle can carry. */
+#define PM_MAX_PORTS            (PM_PORT_MASK + 1)
+
 /* Following API's should be used by all modules to generate port handles */
 
 /* Convert Slot, Module, Port, lport type to physical port handle */
 #define PM_SMPT2HANDLE(slot, module, port, lport_type) \
-    (((port_handle_t)slot << 58) | ((port_handle_t)module << 56)  | \
-     ((port_handle_t)port << 48) | ((port_handle_t)lport_type << 44))
+    (((port_handle_t)slot << PM_SLOT_OFFSET) | \
+     ((port_handle_t)module << PM_MODULE_OFFSET) | \
+     ((port_handle_t)((port) & PM_PORT_MASK) << PM_PORT_OFFSET) | \
+     ((port_handle_t)lport_type << PM_LPORT_TYPE_OFFSET))
 
-#define PM_HANDLE2PORT(handle)   ((int)((handle >> 48) & 0xff)) /* PORT */
+#define PM_HANDLE2PORT(handle) \
+    ((int)(((handle) >> PM_PORT_OFFSET) & PM_PORT_MASK))    /* PORT */
 
 
 /* SPORT Handle (LAG, MLPPP, MPLS)                                           */
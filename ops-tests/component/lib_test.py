@@ -516,3 +516,31 @@ def verify_port_fallback_key(sw, lag, key, expected,  msg):
                            (sw, lag, ['other_config:' + key]),
                            verify_compare_value, [expected])
     assert result == (True, [expected]), msg
+
+
+# Restart lacpd with extra command line options.
+def sw_restart_lacpd(sw, options):
+    cmdline = sw("tr '\\0' ' ' < /proc/$(pidof ops-lacpd)/cmdline",
+                 shell='bash').strip()
+    assert cmdline != '', 'ops-lacpd is not running'
+    if '--detach' not in cmdline:
+        cmdline += ' --detach'
+
+    sw('systemctl stop ops-lacpd', shell='bash')
+    sw('%s %s' % (cmdline, options), shell='bash')
+
+    retries = 20
+    while retries != 0:
+        if sw('pidof ops-lacpd', shell='bash').strip() != '':
+            return
+        sleep(0.5)
+        retries -= 1
+    assert False, 'ops-lacpd did not start with options %s' % options
+
+
+# Stop a lacpd started by sw_restart_lacpd() and start the service again.
+def sw_restore_lacpd(sw):
+    sw('kill $(pidof ops-lacpd)', shell='bash')
+    sw('for i in $(seq 50); do pidof ops-lacpd > /dev/null || break; '
+       'sleep 0.1; done', shell='bash')
+    sw('systemctl start ops-lacpd', shell='bash')
@@ -0,0 +1,139 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+##########################################################################
+# Name:        test_lacpd_ct_config_before_system_configured.py
+#
+# Objective:   Verify that lacpd picks up the interfaces and LAGs that were
+#              inserted and then modified (link_state, other_config) while
+#              the system was not configured yet, once it is.
+#
+# Topology:    2 switches (DUT running Halon) connected by 2 interfaces
+#
+##########################################################################
+
+from time import sleep
+
+from pytest import fixture
+
+from lib_test import (
+    print_header,
+    set_port_parameter,
+    sw_clear_user_config,
+    sw_create_bond,
+    sw_delete_lag,
+    sw_set_intf_pm_info,
+    sw_set_intf_user_config,
+    sw_wait_until_all_sm_ready,
+    sw_wait_until_ready
+)
+
+
+TOPOLOGY = """
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+[type=openswitch name="Switch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+"""
+
+intf_labels = ['1', '2']
+
+# Collecting and distributing, with the fast timeout from other_config.
+active_fast_ready = \
+    '"Activ:1,TmOut:1,Aggr:1,Sync:1,Col:1,Dist:1,Def:0,Exp:0"'
+
+
+def get_cur_cfg(sw):
+    return sw('get system . cur_cfg', shell='vsctl').strip()
+
+
+def set_cur_cfg(sw, value):
+    output = sw('set system . cur_cfg=%s' % value, shell='vsctl')
+    assert output == '', 'Error setting cur_cfg returned %s' % output
+
+
+@fixture()
+def setup(request, topology):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        for intf in intf_labels:
+            sw_set_intf_pm_info(sw, sw.ports[intf],
+                                ('connector="SFP_RJ45"',
+                                 'connector_status=supported',
+                                 'max_speed="1000"',
+                                 'supported_speeds="1000"'))
+
+    cur_cfg = get_cur_cfg(sw1)
+
+    def cleanup():
+        set_cur_cfg(sw1, cur_cfg)
+        sw1('systemctl start ops-lacpd', shell='bash')
+        for sw in [sw1, sw2]:
+            sw_delete_lag(sw, 'lag1')
+            for intf in intf_labels:
+                sw_clear_user_config(sw, sw.ports[intf])
+                sw_set_intf_pm_info(sw, sw.ports[intf],
+                                    ('connector=absent',
+                                     'connector_status=unsupported'))
+
+    request.addfinalizer(cleanup)
+
+    return cur_cfg
+
+
+def test_lacpd_config_before_system_configured(topology, step, setup):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+    cur_cfg = setup
+
+    ports_sw1 = [sw1.ports[intf] for intf in intf_labels]
+    ports_sw2 = [sw2.ports[intf] for intf in intf_labels]
+
+    print_header('Restart lacpd on sw1 with the system not configured')
+    sw1('systemctl stop ops-lacpd', shell='bash')
+    set_cur_cfg(sw1, 0)
+    sw1('systemctl start ops-lacpd', shell='bash')
+
+    step('Change link_state of the interfaces lacpd has not cached yet')
+    for intf in ports_sw1:
+        sw_set_intf_user_config(sw1, intf, ['admin=up'])
+    for intf in ports_sw2:
+        sw_set_intf_user_config(sw2, intf, ['admin=up'])
+    sw_wait_until_ready([sw1, sw2], intf_labels)
+
+    step('Create the LAGs and modify them before the system is configured')
+    for sw, ports in [(sw1, ports_sw1), (sw2, ports_sw2)]:
+        output = sw_create_bond(sw, 'lag1', ports, lacp_mode='active')
+        assert output == '', 'Error creating LAG returned %s' % output
+        set_port_parameter(sw, 'lag1', ['other_config:lacp-time=fast'])
+
+    # Let lacpd see all of the above before it is configured.
+    sleep(2)
+
+    print_header('Configure the system')
+    set_cur_cfg(sw1, cur_cfg)
+
+    step('Verify the LAG negotiates with the fast timeout on both switches')
+    sw_wait_until_all_sm_ready([sw1, sw2], intf_labels, active_fast_ready)
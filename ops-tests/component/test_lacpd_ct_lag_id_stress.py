@@ -0,0 +1,109 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+##########################################################################
+# Name:        test_lacpd_ct_lag_id_stress.py
+#
+# Objective:   Create and delete 1024 LACP LAGs in a loop, verify every
+#              LAG gets a LAG ID and that all of them are released, and
+#              report how long lacpd takes for each round.
+#
+# Topology:    1 switch (DUT running Halon)
+#
+##########################################################################
+
+import re
+from time import time
+
+from lib_test import print_header
+from lib_test import timed_compare
+from lib_test import verify_compare_value
+
+
+TOPOLOGY = """
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+NUM_LAGS = 1024
+LAGS_PER_TRANSACTION = 64
+ROUNDS = 5
+
+
+def stress_lag_name(n):
+    return 'lag%d' % (n + 1)
+
+
+def sw_create_stress_lags(sw, first, count):
+    cmd = ''
+    for n in range(first, first + count):
+        cmd += ('-- --id=@p%d create port name=%s lacp=active '
+                '-- add bridge bridge_normal ports @p%d ' %
+                (n, stress_lag_name(n), n))
+    return sw(cmd, shell='vsctl')
+
+
+def sw_delete_stress_lags(sw, first, count):
+    cmd = ''
+    for n in range(first, first + count):
+        cmd += '-- del-port %s ' % stress_lag_name(n)
+    return sw(cmd, shell='vsctl')
+
+
+def get_lag_ids(sw):
+    """Returns the LAG ID lacpd allocated to each LAG."""
+    out = sw('ovs-appctl -t ops-lacpd lacpd/dump lag_id', shell='bash')
+    lag_ids = {}
+    for lag_id, name in re.findall(r'LAG ID (\d+): (\S+)', out):
+        lag_ids[name] = int(lag_id)
+    return lag_ids
+
+
+def test_lacpd_lag_id_stress(topology, step):
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    for r in range(ROUNDS):
+        print_header('Round %d: create %d LACP LAGs' % (r + 1, NUM_LAGS))
+        start = time()
+        for first in range(0, NUM_LAGS, LAGS_PER_TRANSACTION):
+            output = sw_create_stress_lags(sw1, first, LAGS_PER_TRANSACTION)
+            assert output == '', 'Error creating LAGs returned %s' % output
+
+        result = timed_compare(lambda sw: len(get_lag_ids(sw)), sw1,
+                               verify_compare_value, NUM_LAGS, retries=240)
+        assert result[0], ('%d of %d LAGs got a LAG ID' %
+                           (result[1], NUM_LAGS))
+        step('Round %d: %d LAG IDs allocated in %.2f seconds' %
+             (r + 1, NUM_LAGS, time() - start))
+
+        lag_ids = get_lag_ids(sw1)
+        assert sorted(lag_ids.values()) == list(range(1, NUM_LAGS + 1)), \
+            'LAG IDs are not unique'
+
+        print_header('Round %d: delete %d LACP LAGs' % (r + 1, NUM_LAGS))
+        start = time()
+        for first in range(0, NUM_LAGS, LAGS_PER_TRANSACTION):
+            output = sw_delete_stress_lags(sw1, first, LAGS_PER_TRANSACTION)
+            assert output == '', 'Error deleting LAGs returned %s' % output
+
+        result = timed_compare(lambda sw: len(get_lag_ids(sw)), sw1,
+                               verify_compare_value, 0, retries=240)
+        assert result[0], '%d LAG IDs were not released' % result[1]
+        step('Round %d: %d LAG IDs released in %.2f seconds' %
+             (r + 1, NUM_LAGS, time() - start))
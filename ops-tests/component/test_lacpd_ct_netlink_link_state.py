@@ -0,0 +1,158 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+##########################################################################
+# Name:        test_lacpd_ct_netlink_link_state.py
+#
+# Objective:   Run lacpd with --netlink-link-state, verify that a LAG member
+#              whose kernel link goes down leaves the LAG, that lacpd counts
+#              the link down it took from the kernel, and that the member
+#              joins the LAG again once its link is back up.
+#
+# Topology:    2 switches (DUT running Halon) connected by 2 interfaces
+#
+##########################################################################
+
+import re
+
+from pytest import fixture
+
+from lib_test import (
+    print_header,
+    set_port_parameter,
+    sw_clear_user_config,
+    sw_create_bond,
+    sw_delete_lag,
+    sw_restart_lacpd,
+    sw_restore_lacpd,
+    sw_set_intf_pm_info,
+    sw_set_intf_user_config,
+    sw_wait_until_all_sm_ready,
+    sw_wait_until_ready,
+    verify_intf_in_bond,
+    verify_intf_not_in_bond
+)
+
+
+TOPOLOGY = """
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+[type=openswitch name="Switch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+"""
+
+intf_labels = ['1', '2']
+
+# Everything is working and 'Collecting and Distributing'
+active_ready = '"Activ:1,TmOut:1,Aggr:1,Sync:1,Col:1,Dist:1,Def:0,Exp:0"'
+
+
+def get_link_watch_stats(sw):
+    """Returns the counters of the lacpd/dump link_watch output."""
+    out = sw('ovs-appctl -t ops-lacpd lacpd/dump link_watch', shell='bash')
+    stats = {}
+    for name, value in re.findall(r'^\s*(\w+)\s*:\s*(\S+)', out, re.M):
+        stats[name] = value
+    return stats
+
+
+def set_kernel_link(sw, intf, state):
+    sw('ip link set dev %s %s' % (intf, state), shell='bash_swns')
+
+
+@fixture()
+def setup(request, topology):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        for intf in intf_labels:
+            sw_set_intf_pm_info(sw, sw.ports[intf],
+                                ('connector="SFP_RJ45"',
+                                 'connector_status=supported',
+                                 'max_speed="1000"',
+                                 'supported_speeds="1000"'))
+    sw_restart_lacpd(sw1, '--netlink-link-state')
+
+    def cleanup():
+        set_kernel_link(sw1, sw1.ports['1'], 'up')
+        sw_restore_lacpd(sw1)
+        for sw in [sw1, sw2]:
+            sw_delete_lag(sw, 'lag1')
+            for intf in intf_labels:
+                sw_clear_user_config(sw, sw.ports[intf])
+                sw_set_intf_pm_info(sw, sw.ports[intf],
+                                    ('connector=absent',
+                                     'connector_status=unsupported'))
+
+    request.addfinalizer(cleanup)
+
+
+def test_lacpd_netlink_link_state(topology, step, setup):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    print_header('Create the LAG on both switches')
+    for sw in [sw1, sw2]:
+        for intf in intf_labels:
+            sw_set_intf_user_config(sw, sw.ports[intf], ['admin=up'])
+    sw_wait_until_ready([sw1, sw2], intf_labels)
+
+    for sw in [sw1, sw2]:
+        ports = [sw.ports[intf] for intf in intf_labels]
+        output = sw_create_bond(sw, 'lag1', ports, lacp_mode='active')
+        assert output == '', 'Error creating LAG returned %s' % output
+        set_port_parameter(sw, 'lag1', ['other_config:lacp-time=fast'])
+
+    step('Verify the LAG negotiates')
+    sw_wait_until_all_sm_ready([sw1, sw2], intf_labels, active_ready)
+
+    stats = get_link_watch_stats(sw1)
+    assert stats.get('enabled') == 'true', \
+        'Kernel link watch is not enabled: %s' % stats
+    assert int(stats.get('interfaces', 0)) == len(intf_labels), \
+        'Expected %d interfaces watched: %s' % (len(intf_labels), stats)
+    fast_downs = int(stats['fast_link_downs'])
+
+    print_header('Take the kernel link of interface 1 down on sw1')
+    set_kernel_link(sw1, sw1.ports['1'], 'down')
+
+    step('Verify interface 1 leaves the LAG and interface 2 stays')
+    verify_intf_not_in_bond(sw1, sw1.ports['1'],
+                            'Expected interface 1 to leave the LAG')
+    verify_intf_in_bond(sw1, sw1.ports['2'],
+                        'Expected interface 2 to stay in the LAG')
+
+    step('Verify lacpd took the link down from the kernel')
+    stats = get_link_watch_stats(sw1)
+    assert int(stats['fast_link_downs']) > fast_downs, \
+        'No link down taken from the kernel: %s' % stats
+
+    print_header('Bring the kernel link of interface 1 back up on sw1')
+    set_kernel_link(sw1, sw1.ports['1'], 'up')
+
+    step('Verify interface 1 joins the LAG again')
+    sw_wait_until_all_sm_ready([sw1, sw2], intf_labels, active_ready)
+    for intf in intf_labels:
+        verify_intf_in_bond(sw1, sw1.ports[intf],
+                            'Expected interface %s to be in the LAG' % intf)
@@ -0,0 +1,170 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+##########################################################################
+# Name:        test_lacpd_ct_protocol_shards.py
+#
+# Objective:   Run lacpd with --protocol-shards=2, verify that LAGs run by
+#              different shards negotiate, and that a member moved from a
+#              LAG of one shard to a LAG of the other in one transaction
+#              leaves the first LAG and joins the second.
+#
+# Topology:    2 switches (DUT running Halon) connected by 4 interfaces
+#
+##########################################################################
+
+import re
+
+from pytest import fixture
+
+from lib_test import (
+    print_header,
+    set_port_parameter,
+    sw_clear_user_config,
+    sw_create_bond,
+    sw_delete_lag,
+    sw_restart_lacpd,
+    sw_restore_lacpd,
+    sw_set_intf_pm_info,
+    sw_set_intf_user_config,
+    sw_wait_until_all_sm_ready,
+    sw_wait_until_ready,
+    verify_intf_in_bond,
+    verify_intf_lacp_status
+)
+
+
+TOPOLOGY = """
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+[type=openswitch name="Switch 2"] sw2
+
+# Links
+sw1:1 -- sw2:1
+sw1:2 -- sw2:2
+sw1:3 -- sw2:3
+sw1:4 -- sw2:4
+"""
+
+N_SHARDS = 2
+intf_labels = ['1', '2', '3', '4']
+
+# Everything is working and 'Collecting and Distributing'
+active_ready = '"Activ:1,TmOut:1,Aggr:1,Sync:1,Col:1,Dist:1,Def:0,Exp:0"'
+
+
+def get_lag_ids(sw):
+    """Returns the LAG ID lacpd allocated to each LAG."""
+    out = sw('ovs-appctl -t ops-lacpd lacpd/dump lag_id', shell='bash')
+    lag_ids = {}
+    for lag_id, name in re.findall(r'LAG ID (\d+): (\S+)', out):
+        lag_ids[name] = int(lag_id)
+    return lag_ids
+
+
+def move_intf(sw, intf, from_lag, to_lag):
+    """Moves 'intf' from 'from_lag' to 'to_lag' in one transaction."""
+    intf_uuid = sw('get interface %s _uuid' % intf, shell='vsctl').strip()
+
+    cmd = ''
+    for lag in [from_lag, to_lag]:
+        out = sw('get port %s interfaces' % lag, shell='vsctl')
+        uuids = [u for u in out.strip().strip('[]').replace(' ', '').split(',')
+                 if u != '' and u != intf_uuid]
+        if lag == to_lag:
+            uuids.append(intf_uuid)
+        cmd += '-- set port %s interfaces=[%s] ' % (lag, ','.join(uuids))
+
+    return sw(cmd, shell='vsctl')
+
+
+@fixture()
+def setup(request, topology):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    assert sw1 is not None
+    assert sw2 is not None
+
+    for sw in [sw1, sw2]:
+        for intf in intf_labels:
+            sw_set_intf_pm_info(sw, sw.ports[intf],
+                                ('connector="SFP_RJ45"',
+                                 'connector_status=supported',
+                                 'max_speed="1000"',
+                                 'supported_speeds="1000"'))
+        sw_restart_lacpd(sw, '--protocol-shards=%d' % N_SHARDS)
+
+    def cleanup():
+        for sw in [sw1, sw2]:
+            sw_delete_lag(sw, 'lag1')
+            sw_delete_lag(sw, 'lag2')
+            sw_restore_lacpd(sw)
+            for intf in intf_labels:
+                sw_clear_user_config(sw, sw.ports[intf])
+                sw_set_intf_pm_info(sw, sw.ports[intf],
+                                    ('connector=absent',
+                                     'connector_status=unsupported'))
+
+    request.addfinalizer(cleanup)
+
+
+def test_lacpd_protocol_shards(topology, step, setup):
+    sw1 = topology.get('sw1')
+    sw2 = topology.get('sw2')
+
+    print_header('Create one LAG per shard on both switches')
+    for sw in [sw1, sw2]:
+        for intf in intf_labels:
+            sw_set_intf_user_config(sw, sw.ports[intf], ['admin=up'])
+    sw_wait_until_ready([sw1, sw2], intf_labels)
+
+    for sw in [sw1, sw2]:
+        ports = [sw.ports[intf] for intf in intf_labels]
+        for lag, members in [('lag1', ports[0:2]), ('lag2', ports[2:4])]:
+            output = sw_create_bond(sw, lag, members, lacp_mode='active')
+            assert output == '', 'Error creating LAG returned %s' % output
+            set_port_parameter(sw, lag, ['other_config:lacp-time=fast'])
+
+    step('Verify the LAGs negotiate')
+    sw_wait_until_all_sm_ready([sw1, sw2], intf_labels, active_ready)
+
+    step('Verify the LAGs are run by different shards')
+    for sw in [sw1, sw2]:
+        lag_ids = get_lag_ids(sw)
+        assert 'lag1' in lag_ids and 'lag2' in lag_ids, \
+            'LAG IDs missing: %s' % lag_ids
+        assert lag_ids['lag1'] % N_SHARDS != lag_ids['lag2'] % N_SHARDS, \
+            'Both LAGs are run by the same shard: %s' % lag_ids
+
+    print_header('Move interface 2 from lag1 to lag2')
+    for sw in [sw1, sw2]:
+        output = move_intf(sw, sw.ports['2'], 'lag1', 'lag2')
+        assert output == '', 'Error moving interface returned %s' % output
+
+    step('Verify interface 2 negotiates in lag2 on its new shard')
+    sw_wait_until_all_sm_ready([sw1, sw2], intf_labels, active_ready)
+    for sw in [sw1, sw2]:
+        lag2_key = sw('get interface %s lacp_status:actor_key' %
+                      sw.ports['3'], shell='vsctl').replace('"', '').strip()
+        verify_intf_lacp_status(sw, sw.ports['2'],
+                                {'actor_key': lag2_key},
+                                'Interface 2 moved to lag2')
+        for intf in intf_labels:
+            verify_intf_in_bond(sw, sw.ports[intf],
+                                'Expected interface %s to be in a LAG' %
+                                intf)
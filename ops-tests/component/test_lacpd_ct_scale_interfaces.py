@@ -0,0 +1,138 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+##########################################################################
+# Name:        test_lacpd_ct_scale_interfaces.py
+#
+# Objective:   Verify lacpd can index and run LACP on more interfaces
+#              than the old 256 entry interface index pool allowed.
+#
+# Topology:    1 switch (DUT running Halon)
+#
+##########################################################################
+
+import re
+
+from lib_test import print_header
+from lib_test import timed_compare
+from lib_test import verify_compare_value
+
+
+TOPOLOGY = """
+# Nodes
+[type=openswitch name="OpenSwitch 1"] sw1
+"""
+
+NUM_LAGS = 128
+MEMBERS_PER_LAG = 8
+NUM_INTERFACES = NUM_LAGS * MEMBERS_PER_LAG
+# Keep clear of the switch's own interface IDs.
+FIRST_INTF_ID = 1000
+
+
+def scale_intf_name(n):
+    return 'scale-%d' % n
+
+
+def scale_lag_name(n):
+    return 'lag%d' % (n + 1)
+
+
+def sw_create_scale_lag(sw, lag):
+    """Creates a LACP LAG and its member interfaces in one transaction."""
+    cmd = ''
+    ids = []
+    for m in range(MEMBERS_PER_LAG):
+        n = lag * MEMBERS_PER_LAG + m
+        ids.append('@i%d' % m)
+        cmd += ('-- --id=@i%d create interface name=%s '
+                'hw_intf_info:switch_intf_id=%d user_config:admin=up '
+                'link_state=up link_speed=1000000000 duplex=full ' %
+                (m, scale_intf_name(n), FIRST_INTF_ID + n))
+    cmd += ('-- --id=@p create port name=%s lacp=active interfaces=[%s] '
+            '-- add bridge bridge_normal ports @p' %
+            (scale_lag_name(lag), ','.join(ids)))
+    return sw(cmd, shell='vsctl')
+
+
+def sw_delete_scale_lag(sw, lag):
+    """Deletes a LAG created by sw_create_scale_lag and its interfaces."""
+    cmd = 'del-port %s' % scale_lag_name(lag)
+    for m in range(MEMBERS_PER_LAG):
+        cmd += ' -- destroy interface %s' % \
+            scale_intf_name(lag * MEMBERS_PER_LAG + m)
+    return sw(cmd, shell='vsctl')
+
+
+def get_scale_intf_indexes(sw):
+    """Returns the lacpd interface index of every scale interface."""
+    out = sw('ovs-appctl -t ops-lacpd lacpd/dump interface', shell='bash')
+    indexes = {}
+    pattern = r'Interface (scale-\d+):\s+index\s+:\s+(-?\d+)'
+    for name, index in re.findall(pattern, out):
+        indexes[name] = int(index)
+    return indexes
+
+
+def count_scale_intf_with_lacp_status(sw):
+    out = sw('--columns=name,lacp_status list interface', shell='vsctl')
+    count = 0
+    for record in out.split('\n\n'):
+        if re.search(r'name\s+:\s+"?scale-\d+', record) and \
+           'actor_state' in record:
+            count += 1
+    return count
+
+
+def test_lacpd_scale_interfaces(topology, step):
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    print_header('Create %d LACP LAGs with %d interfaces' %
+                 (NUM_LAGS, NUM_INTERFACES))
+    for lag in range(NUM_LAGS):
+        output = sw_create_scale_lag(sw1, lag)
+        assert output == '', ('Error creating LAG %s returned %s' %
+                              (scale_lag_name(lag), output))
+
+    print_header('Verify every interface got a unique index')
+    result = timed_compare(lambda sw: len(get_scale_intf_indexes(sw)), sw1,
+                           verify_compare_value, NUM_INTERFACES, retries=120)
+    assert result[0], ('lacpd knows about %d of %d interfaces' %
+                       (result[1], NUM_INTERFACES))
+
+    indexes = get_scale_intf_indexes(sw1)
+    assert min(indexes.values()) >= 0, 'Interface without an index'
+    assert len(set(indexes.values())) == NUM_INTERFACES, \
+        'Interface indexes are not unique'
+    assert max(indexes.values()) >= 256, \
+        'Interface indexes did not go past 256'
+
+    print_header('Verify LACP runs on every interface')
+    result = timed_compare(count_scale_intf_with_lacp_status, sw1,
+                           verify_compare_value, NUM_INTERFACES, retries=120)
+    assert result[0], ('LACP is running on %d of %d interfaces' %
+                       (result[1], NUM_INTERFACES))
+
+    print_header('Delete the LAGs and release their indexes')
+    for lag in range(NUM_LAGS):
+        sw_delete_scale_lag(sw1, lag)
+
+    result = timed_compare(lambda sw: len(get_scale_intf_indexes(sw)), sw1,
+                           verify_compare_value, 0, retries=120)
+    assert result[0], ('lacpd still has %d scale interfaces' % result[1])
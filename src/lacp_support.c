@@ -14,6 +14,7 @@
  * under the License.
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,23 +39,70 @@
 #include "mvlan_sport.h"
 #include "lacp_ops_if.h"
 #include <vswitch-idl.h>
+#include <timeval.h>
 
 VLOG_DEFINE_THIS_MODULE(lacpd_support);
 
 /*****************************************************************************
  *                    Global Variables Definition
+ *
+ * Every protocol shard runs LACP on its own set of ports, so all of the
+ * protocol state below is per thread.
  ****************************************************************************/
-unsigned char my_mac_addr[MAC_ADDR_LENGTH] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-uint actor_system_priority = DEFAULT_SYSTEM_PRIORITY;
-
-/* Global per port variables table */
-lacp_avl_tree_t lacp_per_port_vars_tree;
-
-extern struct NList *mlacp_lag_tuple_list;
+__thread unsigned char my_mac_addr[MAC_ADDR_LENGTH] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+__thread uint actor_system_priority = DEFAULT_SYSTEM_PRIORITY;
+
+/* Per port variables table.  The tree keeps ports in lport
+ * handle order for the debug dumps; lookups and the per tick walks use
+ * the port number indexed tables below. */
+__thread lacp_avl_tree_t lacp_per_port_vars_tree;
+
+/* The fields the timer ticks read must share the first cache line. */
+_Static_assert(offsetof(lacp_per_port_variables_t, hw_collecting) + sizeof(int)
+               <= LACP_CACHE_LINE_SIZE,
+               "per port tick fields span more than one cache line");
+
+/* Port number (PM_HANDLE2PORT) -> per port variables. */
+static __thread lacp_per_port_variables_t *lacp_port_by_number[PM_MAX_PORTS];
+
+/* The same ports packed at the front, for LACP_FOR_EACH_PORT. */
+__thread lacp_per_port_variables_t *lacp_port_table[PM_MAX_PORTS];
+__thread int lacp_port_count = 0;
+
+/* Port snapshots for the dumps, which run on the OVS thread.  The shard
+ * running a port publishes what the dumps show of it into the port
+ * number's slot under a sequence lock: a writer takes the slot by making
+ * the sequence odd, and readers retry until they copied the data while
+ * the sequence was even and unchanged.  Readers never block the shards,
+ * and always see all fields of a port from the same moment. */
+typedef struct port_snapshot_slot {
+    unsigned int seq;
+    lacp_port_snapshot_t data;
+} port_snapshot_slot_t;
+
+static port_snapshot_slot_t port_snapshots[PM_MAX_PORTS];
+
+/* Ports with side effects left to apply after the batch of events being
+ * handled, see LACP_effects_apply().  Outside of an event they are applied right
+ * away, and so are detaches at any time. */
+static __thread lacp_per_port_variables_t *effects_pending[PM_MAX_PORTS];
+static __thread int effects_n_pending = 0;
+static __thread bool effects_deferred = false;
+static __thread int effects_n_requested = 0;
+static __thread int effects_n_applied = 0;
 
 /*****************************************************************************
  *          Prototypes for static functions
  ****************************************************************************/
+static void sport_priority_unlink(lacp_per_port_variables_t *plpinfo);
+static int port_table_insert(lacp_per_port_variables_t *plpinfo);
+static void port_table_remove(lacp_per_port_variables_t *plpinfo);
+static void unpublish_port(lacp_per_port_variables_t *plpinfo);
+static void effects_queue(lacp_per_port_variables_t *plpinfo);
+static void effects_apply_port(lacp_per_port_variables_t *plpinfo);
+static void effects_apply_detach(lacp_per_port_variables_t *plpinfo);
+static void effects_unqueue(lacp_per_port_variables_t *plpinfo);
+static void effects_check_bringup(lacp_per_port_variables_t *plpinfo);
 static void initialize_per_port_variables(
                               lacp_per_port_variables_t *plpinfo,
                               unsigned short port_id,
@@ -119,7 +167,7 @@ LACP_initialize_port(port_handle_t lport_handle,
 
     /* RDEBUG exists in the caller ... */
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
 
     /* Should not happen, but if LACP is already running
      * on this port, just kill it and restart with the latest
@@ -128,14 +176,11 @@ LACP_initialize_port(port_handle_t lport_handle,
         status = mvlan_get_sport(plpinfo->sport_handle , &psport,
                                  MLm_vpm_api__get_sport);
         if (R_SUCCESS == status) {
-            plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-            while (plpinfo_priority) {
-                if (plpinfo_priority->lport_handle != plpinfo->lport_handle &&
-                    plpinfo_priority->sport_handle == psport->handle &&
+            SPORT_FOR_EACH_LPORT(plpinfo_priority, psport) {
+                if (plpinfo_priority != plpinfo &&
                     max_port_priority > plpinfo_priority->actor_admin_port_priority) {
                     max_port_priority = plpinfo_priority->actor_admin_port_priority;
                 }
-                plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
             }
             placp_sport_params = psport->placp_params;
             placp_sport_params->lacp_params.actor_max_port_priority = max_port_priority;
@@ -151,17 +196,18 @@ LACP_initialize_port(port_handle_t lport_handle,
     /* First time adding the lport. */
     RDEBUG(DL_INFO, "alloc data structure for lport 0x%llx\n", lport_handle);
 
-    plpinfo = calloc(1, sizeof(lacp_per_port_variables_t));
-    if (plpinfo == NULL) {
+    /* Cache line aligned, so the hot fields stay in their own lines. */
+    if (posix_memalign((void **)&plpinfo, LACP_CACHE_LINE_SIZE,
+                       sizeof(lacp_per_port_variables_t)) != 0) {
         VLOG_FATAL("out of memory");
         exit(-1);
     }
+    memset(plpinfo, 0, sizeof(lacp_per_port_variables_t));
 
     plpinfo->lport_handle = lport_handle;
-    LACP_AVL_INIT_NODE(plpinfo->avlnode, plpinfo, &(plpinfo->lport_handle));
 
-    if (LACP_AVL_INSERT(lacp_per_port_vars_tree, plpinfo->avlnode) == FALSE) {
-        VLOG_FATAL("avl_insert failed for handle 0x%llx", lport_handle);
+    if (port_table_insert(plpinfo) == FALSE) {
+        VLOG_FATAL("port table insert failed for handle 0x%llx", lport_handle);
         exit(-1);
     }
 
@@ -287,7 +333,7 @@ LACP_update_port_params(port_handle_t lport_handle,
 
     RENTRY();
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
 
     if (plpinfo != NULL) {
 
@@ -488,13 +534,11 @@ LACP_disable_lacp(port_handle_t lport_handle)
 {
 
     LAG_t *lag;
-    struct NList *pdummy;
-    lacp_lag_ppstruct_t *plag_port_struct = NULL;
     lacp_per_port_variables_t *plpinfo;
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("Disable LACP: lport_handle 0x%llx not found",
                  lport_handle);
@@ -513,46 +557,29 @@ LACP_disable_lacp(port_handle_t lport_handle)
         mlacp_blocking_send_detach_aggregator(plpinfo);
     }
 
+    /* The port is going away, apply what it still has pending while
+     * it is in its LAG. */
+    effects_apply_port(plpinfo);
+    effects_unqueue(plpinfo);
+
     lag = plpinfo->lag;
 
     if (lag != NULL) {
-        /*
-         * Can be optimized by putting a pointer
-         * to plag_port_struct in the perport variables
-         */
-        pdummy = n_list_find_data(lag->pplist,
-                                  &lacp_lag_port_match,
-                                  &plpinfo->lport_handle);
-        if (pdummy != NULL) {
-            plag_port_struct = pdummy->data;
-            if(plag_port_struct != NULL) {
-                lag->pplist =  n_list_remove_data(lag->pplist, plag_port_struct);
-            }
-        }
+        LAG_remove_member(lag, plpinfo);
 
-        if (lag->pplist == NULL) {
+        if (lag->num_members == 0) {
             /*
              * It was the last port in the LAG, remove the whole LAG.
+             * This also clears out the sport params so they can be
+             * reused later.
              */
-
-            // clear out sport params so it can be reused later.
-            if (lag->sp_handle != 0) {
-                mlacp_blocking_send_clear_aggregator(lag->sp_handle);
-            }
-
             plpinfo->lag = NULL;
-            free(lag->LAG_Id);
-
-            //*********************************************************
-            // Remove the LAG from the tuple_list before we free it.
-            //*********************************************************
-            mlacp_lag_tuple_list = n_list_remove_data(
-                                               mlacp_lag_tuple_list,
-                                               lag);
-            free(lag);
+            LAG_delete(lag);
         }
     }
-    LACP_AVL_DELETE(lacp_per_port_vars_tree,plpinfo->avlnode);
+
+    LACP_set_sport_handle(plpinfo, 0);
+    port_table_remove(plpinfo);
 
     //****************************************************************
     // As LACP is per-port, go ahead & de-register for this port.
@@ -563,6 +590,638 @@ LACP_disable_lacp(port_handle_t lport_handle)
 
 } /* LACP_disable_lacp */
 
+//***************************************************************
+// Function : LACP_find_port
+//***************************************************************
+// Returns the per port variables of an lport with LACP enabled, or
+// NULL.  The port number in the handle indexes the table directly.
+lacp_per_port_variables_t *
+LACP_find_port(port_handle_t lport_handle)
+{
+    lacp_per_port_variables_t *plpinfo;
+
+    plpinfo = lacp_port_by_number[PM_HANDLE2PORT(lport_handle)];
+    if (plpinfo != NULL && plpinfo->lport_handle == lport_handle) {
+        return plpinfo;
+    }
+
+    return NULL;
+
+} /* LACP_find_port */
+
+//***************************************************************
+// Function : port_table_insert
+//***************************************************************
+static int
+port_table_insert(lacp_per_port_variables_t *plpinfo)
+{
+    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+
+    if (lacp_port_by_number[port] != NULL) {
+        return FALSE;
+    }
+
+    LACP_AVL_INIT_NODE(plpinfo->avlnode, plpinfo, &(plpinfo->lport_handle));
+    if (LACP_AVL_INSERT(lacp_per_port_vars_tree, plpinfo->avlnode) == FALSE) {
+        return FALSE;
+    }
+
+    lacp_port_by_number[port] = plpinfo;
+    plpinfo->port_table_slot = lacp_port_count;
+    lacp_port_table[lacp_port_count++] = plpinfo;
+
+    return TRUE;
+
+} /* port_table_insert */
+
+//***************************************************************
+// Function : port_table_remove
+//***************************************************************
+// Fills the hole with the last entry so the table stays packed.
+static void
+port_table_remove(lacp_per_port_variables_t *plpinfo)
+{
+    int slot = plpinfo->port_table_slot;
+
+    LACP_AVL_DELETE(lacp_per_port_vars_tree, plpinfo->avlnode);
+    lacp_port_by_number[PM_HANDLE2PORT(plpinfo->lport_handle)] = NULL;
+    unpublish_port(plpinfo);
+
+    lacp_port_count--;
+    lacp_port_table[slot] = lacp_port_table[lacp_port_count];
+    lacp_port_table[slot]->port_table_slot = slot;
+    lacp_port_table[lacp_port_count] = NULL;
+
+} /* port_table_remove */
+
+//***************************************************************
+// Function : snapshot_write_begin
+//***************************************************************
+// Takes the slot for writing.  While a port moves between shards
+// both may write its slot, so writers take turns.
+static unsigned int
+snapshot_write_begin(port_snapshot_slot_t *slot)
+{
+    unsigned int seq;
+
+    for (;;) {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        if (!(seq & 1) &&
+            __atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return seq;
+
+} /* snapshot_write_begin */
+
+//***************************************************************
+// Function : snapshot_write_end
+//***************************************************************
+static void
+snapshot_write_end(port_snapshot_slot_t *slot, unsigned int seq)
+{
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+} /* snapshot_write_end */
+
+//***************************************************************
+// Function : LACP_publish_port
+//***************************************************************
+void
+LACP_publish_port(lacp_per_port_variables_t *plpinfo)
+{
+    port_snapshot_slot_t *slot;
+    lacp_port_snapshot_t *snap;
+    unsigned int seq;
+
+    slot = &port_snapshots[PM_HANDLE2PORT(plpinfo->lport_handle)];
+    snap = &slot->data;
+
+    seq = snapshot_write_begin(slot);
+
+    snap->valid = true;
+    snap->shard = ml_shard_id;
+    snap->actor_oper_port_state = plpinfo->actor_oper_port_state;
+    snap->partner_oper_port_state = plpinfo->partner_oper_port_state;
+    snap->lacp_control = plpinfo->lacp_control;
+    snap->lacp_pdus_sent = plpinfo->lacp_pdus_sent;
+    snap->marker_response_pdus_sent = plpinfo->marker_response_pdus_sent;
+    snap->lacp_pdus_received = plpinfo->lacp_pdus_received;
+    snap->marker_pdus_received = plpinfo->marker_pdus_received;
+
+    snapshot_write_end(slot, seq);
+
+} /* LACP_publish_port */
+
+//***************************************************************
+// Function : LACP_publish_port_lag
+//***************************************************************
+// Publishes the port and the other members of its LAG, which are
+// all a received LACPDU can change.
+void
+LACP_publish_port_lag(port_handle_t lport_handle)
+{
+    lacp_per_port_variables_t *plpinfo;
+    lacp_per_port_variables_t *member;
+
+    plpinfo = LACP_find_port(lport_handle);
+    if (plpinfo == NULL) {
+        return;
+    }
+
+    LACP_publish_port(plpinfo);
+
+    if (plpinfo->lag != NULL) {
+        LAG_FOR_EACH_MEMBER(member, plpinfo->lag) {
+            if (member != plpinfo) {
+                LACP_publish_port(member);
+            }
+        }
+    }
+
+} /* LACP_publish_port_lag */
+
+//***************************************************************
+// Function : LACP_publish_all_ports
+//***************************************************************
+void
+LACP_publish_all_ports(void)
+{
+    lacp_per_port_variables_t *plpinfo;
+    int i;
+
+    LACP_FOR_EACH_PORT(plpinfo, i) {
+        LACP_publish_port(plpinfo);
+    }
+
+} /* LACP_publish_all_ports */
+
+//***************************************************************
+// Function : unpublish_port
+//***************************************************************
+// Unless the port has moved to another shard meanwhile, its
+// snapshot is dropped with it.
+static void
+unpublish_port(lacp_per_port_variables_t *plpinfo)
+{
+    port_snapshot_slot_t *slot;
+    unsigned int seq;
+
+    slot = &port_snapshots[PM_HANDLE2PORT(plpinfo->lport_handle)];
+
+    seq = snapshot_write_begin(slot);
+    if (slot->data.shard == ml_shard_id) {
+        slot->data.valid = false;
+    }
+    snapshot_write_end(slot, seq);
+
+} /* unpublish_port */
+
+//***************************************************************
+// Function : LACP_read_port_snapshot
+//***************************************************************
+// Copies the port's last published snapshot.  Returns false if no
+// shard runs LACP on the port.  Never blocks the protocol shards.
+bool
+LACP_read_port_snapshot(int port, lacp_port_snapshot_t *snap)
+{
+    port_snapshot_slot_t *slot;
+    unsigned int seq;
+
+    if (port < 0 || port >= PM_MAX_PORTS) {
+        return false;
+    }
+
+    slot = &port_snapshots[port];
+
+    do {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(snap, &slot->data, sizeof(*snap));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq);
+
+    return snap->valid;
+
+} /* LACP_read_port_snapshot */
+
+//***************************************************************
+// Function : LACP_effects_begin
+//***************************************************************
+// From here on the side effects the state machines ask for are
+// recorded in the ports' pending_effects, until LACP_effects_apply().
+void
+LACP_effects_begin(void)
+{
+    effects_deferred = true;
+    effects_n_requested = 0;
+    effects_n_applied = 0;
+
+} /* LACP_effects_begin */
+
+//***************************************************************
+// Function : LACP_effects_apply
+//***************************************************************
+// Applies the side effects recorded since LACP_effects_begin(), one
+// update per port and kind.  All of them go to the OVS thread as one
+// group, so the members of a LAG that became ready together are
+// attached and enabled in the same transaction.  Detaches are not in
+// the group, effects_queue() has already sent them.  Returns how many
+// updates the state machines asked for and how many were sent.
+void
+LACP_effects_apply(int *n_requested, int *n_applied)
+{
+    lacp_per_port_variables_t *plpinfo;
+    int i;
+
+    if (effects_n_pending > 0) {
+        lacpd_delta_hold();
+        for (i = 0; i < effects_n_pending; i++) {
+            effects_apply_port(effects_pending[i]);
+        }
+        lacpd_delta_release();
+    }
+
+    for (i = 0; i < effects_n_pending; i++) {
+        plpinfo = effects_pending[i];
+        if (plpinfo->pending_effects.hw_tx_enabled &&
+            plpinfo->pending_effects.first_pdu != 0) {
+            effects_check_bringup(plpinfo);
+        }
+        plpinfo->pending_effects.queued = false;
+        effects_pending[i] = NULL;
+    }
+    effects_n_pending = 0;
+    effects_deferred = false;
+
+    *n_requested = effects_n_requested;
+    *n_applied = effects_n_applied;
+
+} /* LACP_effects_apply */
+
+//***************************************************************
+// Function : LACP_effects_pdu_received
+//***************************************************************
+// Starts timing the bring-up of the port's LAG on the first LACPDU
+// the port receives while egress is disabled.
+void
+LACP_effects_pdu_received(port_handle_t lport_handle)
+{
+    lacp_per_port_variables_t *plpinfo = LACP_find_port(lport_handle);
+
+    if (plpinfo != NULL &&
+        !plpinfo->pending_effects.hw_tx_enabled &&
+        plpinfo->pending_effects.first_pdu == 0) {
+        plpinfo->pending_effects.first_pdu = time_msec();
+    }
+
+} /* LACP_effects_pdu_received */
+
+//***************************************************************
+// Function : effects_check_bringup
+//***************************************************************
+// Once egress is enabled on all members of the port's LAG, records
+// the time since the first of them received a LACPDU.
+static void
+effects_check_bringup(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_per_port_variables_t *member;
+    long long first = 0;
+
+    if (plpinfo->lag == NULL) {
+        return;
+    }
+
+    LAG_FOR_EACH_MEMBER(member, plpinfo->lag) {
+        const lacp_pending_effects_t *fx = &member->pending_effects;
+
+        if (!fx->hw_tx_enabled) {
+            return;
+        }
+        if (fx->first_pdu != 0 && (first == 0 || fx->first_pdu < first)) {
+            first = fx->first_pdu;
+        }
+    }
+
+    LAG_FOR_EACH_MEMBER(member, plpinfo->lag) {
+        member->pending_effects.first_pdu = 0;
+    }
+
+    ml_record_lag_bringup(time_msec() - first);
+
+} /* effects_check_bringup */
+
+//***************************************************************
+// Function : effects_queue
+//***************************************************************
+// While deferred, a detach is still sent right away: traffic must
+// stop on a port that left its LAG without waiting for the rest of
+// the batch.  Only attach, egress enable and status wait for it.
+static void
+effects_queue(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+
+    if (!effects_deferred) {
+        effects_apply_port(plpinfo);
+        return;
+    }
+
+    effects_apply_detach(plpinfo);
+
+    if (!fx->queued) {
+        fx->queued = true;
+        fx->slot = effects_n_pending;
+        effects_pending[effects_n_pending++] = plpinfo;
+    }
+
+} /* effects_queue */
+
+//***************************************************************
+// Function : effects_unqueue
+//***************************************************************
+// Fills the hole with the last entry so the list stays packed.
+static void
+effects_unqueue(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+
+    if (!fx->queued) {
+        return;
+    }
+
+    effects_n_pending--;
+    effects_pending[fx->slot] = effects_pending[effects_n_pending];
+    effects_pending[fx->slot]->pending_effects.slot = fx->slot;
+    effects_pending[effects_n_pending] = NULL;
+    fx->queued = false;
+
+} /* effects_unqueue */
+
+//***************************************************************
+// Function : effects_apply_detach
+//***************************************************************
+// Detaches the port in h/w if it is attached to another LAG than the
+// wanted one, or if egress had been enabled and is wanted off, since
+// there is no update that only disables egress.
+static void
+effects_apply_detach(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+
+    if (fx->hw_attached &&
+        (!fx->attached || fx->lag_id != fx->hw_lag_id ||
+         (fx->hw_tx_enabled && !fx->tx_enabled))) {
+        ops_detach_port_in_hw(fx->hw_lag_id, port);
+        db_delete_lag_port(fx->hw_lag_id, port, plpinfo);
+        fx->hw_attached = false;
+        fx->hw_tx_enabled = false;
+        effects_n_applied += 2;
+    }
+
+} /* effects_apply_detach */
+
+//***************************************************************
+// Function : effects_apply_port
+//***************************************************************
+// Sends the OVS thread what it takes to get from the h/w state last
+// sent to the wanted one.
+static void
+effects_apply_port(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+
+    effects_apply_detach(plpinfo);
+
+    if (fx->attached && !fx->hw_attached) {
+        ops_attach_port_in_hw(fx->lag_id, port);
+        db_add_lag_port(fx->lag_id, port, plpinfo);
+        fx->hw_attached = true;
+        fx->hw_lag_id = fx->lag_id;
+        effects_n_applied += 2;
+    }
+
+    if (fx->attached && fx->tx_enabled && !fx->hw_tx_enabled) {
+        ops_trunk_port_egr_enable(fx->lag_id, port);
+        fx->hw_tx_enabled = true;
+        effects_n_applied++;
+    }
+
+    if (fx->status) {
+        db_update_interface(plpinfo);
+        fx->status = false;
+        effects_n_applied++;
+    }
+
+} /* effects_apply_port */
+
+//***************************************************************
+// Function : LACP_effect_status
+//***************************************************************
+// The port's lacp_status may have changed.
+void
+LACP_effect_status(lacp_per_port_variables_t *plpinfo)
+{
+    plpinfo->pending_effects.status = true;
+    effects_n_requested++;
+    effects_queue(plpinfo);
+
+} /* LACP_effect_status */
+
+//***************************************************************
+// Function : LACP_effect_attach
+//***************************************************************
+// The port collects on LAG lag_id: attach it in h/w and add it to the
+// LAG's participants in DB.
+void
+LACP_effect_attach(lacp_per_port_variables_t *plpinfo, int lag_id)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+
+    fx->attached = true;
+    fx->lag_id = lag_id;
+    effects_n_requested += 2;
+    effects_queue(plpinfo);
+
+} /* LACP_effect_attach */
+
+//***************************************************************
+// Function : LACP_effect_egress_enable
+//***************************************************************
+// The port distributes on the LAG it is attached to.
+void
+LACP_effect_egress_enable(lacp_per_port_variables_t *plpinfo)
+{
+    plpinfo->pending_effects.tx_enabled = true;
+    effects_n_requested++;
+    effects_queue(plpinfo);
+
+} /* LACP_effect_egress_enable */
+
+//***************************************************************
+// Function : LACP_effect_detach
+//***************************************************************
+// The port neither collects nor distributes: detach it in h/w and
+// remove it from the LAG's participants in DB.
+void
+LACP_effect_detach(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_pending_effects_t *fx = &plpinfo->pending_effects;
+
+    fx->attached = false;
+    fx->tx_enabled = false;
+    effects_n_requested += 2;
+    effects_queue(plpinfo);
+
+} /* LACP_effect_detach */
+
+//***************************************************************
+// Function : LACP_set_sport_handle
+//***************************************************************
+// Records the aggregator the port has selected, and moves the port
+// onto that super port's lport list.  0 takes it off any list.
+void
+LACP_set_sport_handle(lacp_per_port_variables_t *plpinfo,
+                      port_handle_t sport_handle)
+{
+    super_port_t *psport = plpinfo->sport_member.psport;
+    lacp_per_port_variables_t *prev = NULL;
+    lacp_per_port_variables_t *next;
+
+    if (psport != NULL) {
+        sport_priority_unlink(plpinfo);
+
+        if (plpinfo->sport_member.prev) {
+            plpinfo->sport_member.prev->sport_member.next =
+                plpinfo->sport_member.next;
+        } else {
+            psport->plport_list = plpinfo->sport_member.next;
+        }
+
+        if (plpinfo->sport_member.next) {
+            plpinfo->sport_member.next->sport_member.prev =
+                plpinfo->sport_member.prev;
+        }
+
+        plpinfo->sport_member.next = NULL;
+        plpinfo->sport_member.prev = NULL;
+        plpinfo->sport_member.psport = NULL;
+    }
+
+    plpinfo->sport_handle = sport_handle;
+
+    if (sport_handle == 0 ||
+        mvlan_get_sport(sport_handle, &psport,
+                        MLm_vpm_api__get_sport) != R_SUCCESS) {
+        return;
+    }
+
+    for (next = psport->plport_list; next; next = next->sport_member.next) {
+        if (next->lport_handle > plpinfo->lport_handle) {
+            break;
+        }
+        prev = next;
+    }
+
+    plpinfo->sport_member.prev = prev;
+    plpinfo->sport_member.next = next;
+    plpinfo->sport_member.psport = psport;
+
+    if (prev) {
+        prev->sport_member.next = plpinfo;
+    } else {
+        psport->plport_list = plpinfo;
+    }
+
+    if (next) {
+        next->sport_member.prev = plpinfo;
+    }
+
+    LACP_update_sport_priority(plpinfo);
+
+} /* LACP_set_sport_handle */
+
+//***************************************************************
+// Function : LACP_update_sport_priority
+//***************************************************************
+// Puts the port back in its place on its super port's priority
+// list.  Must be called whenever the port's actor_oper_port_priority
+// or receive machine state changes.
+void
+LACP_update_sport_priority(lacp_per_port_variables_t *plpinfo)
+{
+    super_port_t *psport = plpinfo->sport_member.psport;
+    lacp_per_port_variables_t *prev = NULL;
+    lacp_per_port_variables_t *next;
+
+    sport_priority_unlink(plpinfo);
+
+    if (psport == NULL ||
+        plpinfo->recv_fsm_state == RECV_FSM_DEFAULTED_STATE) {
+        return;
+    }
+
+    for (next = psport->pprio_list; next; next = next->sport_member.prio_next) {
+        if (next->actor_oper_port_priority > plpinfo->actor_oper_port_priority) {
+            break;
+        }
+        prev = next;
+    }
+
+    plpinfo->sport_member.prio_prev = prev;
+    plpinfo->sport_member.prio_next = next;
+    plpinfo->sport_member.on_prio_list = TRUE;
+
+    if (prev) {
+        prev->sport_member.prio_next = plpinfo;
+    } else {
+        psport->pprio_list = plpinfo;
+    }
+
+    if (next) {
+        next->sport_member.prio_prev = plpinfo;
+    }
+
+} /* LACP_update_sport_priority */
+
+//***************************************************************
+// Function : sport_priority_unlink
+//***************************************************************
+static void
+sport_priority_unlink(lacp_per_port_variables_t *plpinfo)
+{
+    super_port_t *psport = plpinfo->sport_member.psport;
+
+    if (!plpinfo->sport_member.on_prio_list) {
+        return;
+    }
+
+    if (plpinfo->sport_member.prio_prev) {
+        plpinfo->sport_member.prio_prev->sport_member.prio_next =
+            plpinfo->sport_member.prio_next;
+    } else {
+        psport->pprio_list = plpinfo->sport_member.prio_next;
+    }
+
+    if (plpinfo->sport_member.prio_next) {
+        plpinfo->sport_member.prio_next->sport_member.prio_prev =
+            plpinfo->sport_member.prio_prev;
+    }
+
+    plpinfo->sport_member.prio_next = NULL;
+    plpinfo->sport_member.prio_prev = NULL;
+    plpinfo->sport_member.on_prio_list = FALSE;
+
+} /* sport_priority_unlink */
+
 
 /*----------------------------------------------------------------------
  * Function: set_actor_admin_parms_2_oper(int port_number)
@@ -585,6 +1244,7 @@ set_actor_admin_parms_2_oper(lacp_per_port_variables_t *plpinfo,
 
     if (params_to_be_set & PORT_PRIORITY_BIT) {
         plpinfo->actor_oper_port_priority = plpinfo->actor_admin_port_priority;
+        LACP_update_sport_priority(plpinfo);
     }
 
     if (params_to_be_set & PORT_KEY_BIT) {
@@ -741,7 +1401,7 @@ print_lacp_fsm_state(port_handle_t lport_handle)
     char state_string[STATE_STRING_SIZE];
     lacp_per_port_variables_t *lacp_port;
 
-    lacp_port = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    lacp_port = LACP_find_port(lport_handle);
     if (lacp_port == NULL) {
         VLOG_ERR(" fsm print - can't find lport 0x%llx", lport_handle);
         return;
@@ -1024,7 +1684,7 @@ mlacpVapiLinkUp(port_handle_t lport_handle, int speed)
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("link up but can't find lport 0x%llx", lport_handle);
         return;
@@ -1090,7 +1750,7 @@ mlacpVapiLinkDown(port_handle_t lport_handle)
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("link down, but can't find lport 0x%llx", lport_handle);
         return;
@@ -1127,17 +1787,15 @@ void
 set_all_port_system_mac_addr(void)
 {
     lacp_per_port_variables_t *plpinfo;
+    int i;
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
+    LACP_FOR_EACH_PORT(plpinfo, i) {
         if (plpinfo->actor_sys_id_override == FALSE) {
             memcpy(plpinfo->actor_admin_system_variables.system_mac_addr, my_mac_addr,
                    MAC_ADDR_LENGTH);
             memcpy(plpinfo->actor_oper_system_variables.system_mac_addr, my_mac_addr,
                    MAC_ADDR_LENGTH);
         }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
     }
 
 } /* set_all_port_system_mac_addr */
@@ -1149,20 +1807,17 @@ void
 set_all_port_system_priority(void)
 {
     lacp_per_port_variables_t *plpinfo;
+    int i;
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
+    LACP_FOR_EACH_PORT(plpinfo, i) {
         if (plpinfo->actor_prio_override == FALSE) {
             plpinfo->actor_admin_system_variables.system_priority =
                 htons(actor_system_priority);
             plpinfo->actor_oper_system_variables.system_priority =
                 plpinfo->actor_admin_system_variables.system_priority;
             /* Update interface status when a system setting changes */
-            db_update_interface(plpinfo);
+            LACP_effect_status(plpinfo);
         }
-
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
     }
 
 } /* set_all_port_system_priority */
@@ -1178,7 +1833,7 @@ set_lport_fallback_status(port_handle_t lport_handle, int status)
 {
     lacp_per_port_variables_t *plpinfo = NULL;
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
 
     if (plpinfo != NULL) {
         plpinfo->fallback_enabled = status;
@@ -1206,7 +1861,7 @@ set_lport_overrides(port_handle_t lport_handle, int prio, unsigned char *mac)
 {
     lacp_per_port_variables_t *plpinfo;
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
 
     if (plpinfo != NULL) {
         /* process priority */
@@ -1258,30 +1913,32 @@ void
 mlacpVapiSportParamsChange(int msg __attribute__ ((unused)),
                            struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
 {
-    lacp_per_port_variables_t *plpinfo, *lacp_port;
+    lacp_per_port_variables_t *lacp_port, *next;
+    super_port_t *psport;
 
     RDEBUG(DL_INFO, "%s: sport_handle 0x%llx\n", __FUNCTION__,
            pin_lacp_params->sport_handle);
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
-        if (plpinfo->sport_handle == pin_lacp_params->sport_handle) {
-            lacp_port = plpinfo;
-
-            if (pin_lacp_params->flags &
-                (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
-                 LACP_LAG_PARTNER_SYSID_FIELD_PRESENT)) {
-                /*
-                 * Make selected UNSELECTED, and cause approp. event in
-                 * the mux machine.
-                 */
-                lacp_port->lacp_control.selected = UNSELECTED;
-                LACP_mux_fsm(E2, lacp_port->mux_fsm_state, lacp_port);
-                lacp_port->lacp_control.ready_n = FALSE;
-            }
-        }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+    if (!(pin_lacp_params->flags &
+          (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
+           LACP_LAG_PARTNER_SYSID_FIELD_PRESENT))) {
+        return;
+    }
+
+    if (mvlan_get_sport(pin_lacp_params->sport_handle, &psport,
+                        MLm_vpm_api__get_sport) != R_SUCCESS) {
+        return;
+    }
+
+    /* E2 may detach the port, which takes it off the lport list. */
+    SPORT_FOR_EACH_LPORT_SAFE(lacp_port, next, psport) {
+        /*
+         * Make selected UNSELECTED, and cause approp. event in
+         * the mux machine.
+         */
+        lacp_port->lacp_control.selected = UNSELECTED;
+        LACP_mux_fsm(E2, lacp_port->mux_fsm_state, lacp_port);
+        lacp_port->lacp_control.ready_n = FALSE;
     }
 
 } /* mlacpVapiSportParamsChange */
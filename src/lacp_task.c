@@ -59,7 +59,6 @@ static marker_pdu_payload_t *LACP_build_marker_response_payload(
                                            port_handle_t, marker_pdu_payload_t *);
 static void LACP_transmit_marker_response(port_handle_t, void *);
 static int is_pkt_from_same_system(lacp_per_port_variables_t *, lacpdu_payload_t *);
-int lacp_lag_port_match(void *, void *);
 
 
 /**************************************************************
@@ -77,12 +76,11 @@ void
 LACP_periodic_tx(void)
 {
     lacp_per_port_variables_t *plpinfo;
+    int i;
 
     RENTRY();
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
+    LACP_FOR_EACH_PORT(plpinfo, i) {
         if (plpinfo->debug_level & DBG_TX_FSM) {
             print_lacp_fsm_state(plpinfo->lport_handle);
         }
@@ -91,7 +89,6 @@ LACP_periodic_tx(void)
             periodic_tx_timer_expiry(plpinfo);
             mux_wait_while_timer_expiry(plpinfo);
         }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
     }
 
     REXIT();
@@ -183,13 +180,11 @@ mux_wait_while_timer_expiry(lacp_per_port_variables_t *lacp_port)
         return;
     }
 
-    if (lag->pplist == NULL) {
+    if (lag->num_members == 0) {
         return;
     }
 
-    if (n_list_find_data(lag->pplist,
-                         &lacp_lag_port_match,
-                         &lacp_port->lport_handle) == NULL) {
+    if (!LAG_IS_MEMBER(lag, lacp_port)) {
         VLOG_ERR("lport (ox%llx) not set ??", lacp_port->lport_handle);
         return;
     }
@@ -211,16 +206,7 @@ mux_wait_while_timer_expiry(lacp_per_port_variables_t *lacp_port)
             lacp_port->lacp_control.ready_n = TRUE;
             lag->ready = TRUE;      /* assume */
 
-            for (plp = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-                 plp;
-                 plp = LACP_AVL_NEXT(plp->avlnode)) {
-
-                if (n_list_find_data(lag->pplist,
-                                     &lacp_lag_port_match,
-                                     &plp->lport_handle) == NULL) {
-                    continue;
-                }
-
+            LAG_FOR_EACH_MEMBER(plp, lag) {
                 if (plp->lacp_control.ready_n == FALSE) {
                     lag->ready = FALSE;
                     break;
@@ -261,11 +247,11 @@ void
 LACP_current_while_expiry(void)
 {
     lacp_per_port_variables_t *lacp_port;
+    int i;
 
     RENTRY();
 
-    lacp_port = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-    while (lacp_port) {
+    LACP_FOR_EACH_PORT(lacp_port, i) {
         if (lacp_port->lacp_up == TRUE) { /* LACP port is initialized */
 
             RDEBUG(DL_TIMERS, "invoke current_while_timer_expiry.  lport=0x%llx\n",
@@ -273,8 +259,6 @@ LACP_current_while_expiry(void)
 
             current_while_timer_expiry(lacp_port);
         }
-
-        lacp_port = LACP_AVL_NEXT(lacp_port->avlnode);
     }
 
     REXIT();
@@ -339,7 +323,7 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
 
     RENTRY();
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_find_port(lport_handle);
     if (plpinfo == NULL || plpinfo->lacp_up == FALSE) {
         VLOG_WARN("Got LACPDU, but LACP not enabled (port 0x%llx)",
                   lport_handle);
@@ -621,17 +605,3 @@ is_pkt_from_same_system(lacp_per_port_variables_t *plpinfo,
     return status;
 
 } /* is_pkt_from_same_system */
-
-int
-lacp_lag_port_match(void *v1, void *v2)
-{
-    lacp_lag_ppstruct_t *ppstruct = v1;
-    port_handle_t lport_handle = *(port_handle_t *)v2;
-
-    if (ppstruct->lport_handle == lport_handle) {
-        return 1;
-    } else {
-        return 0;
-    }
-
-} /* lacp_lag_port_match */
@@ -34,10 +34,15 @@
  *       5. Dynamically configure hardware based on
  *          operational state changes as needed.
  ***************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
 #include <getopt.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 
 #include <util.h>
@@ -68,10 +73,41 @@ static unixctl_cb_func lacpd_unixctl_dump;
 static unixctl_cb_func lacpd_unixctl_getlacpinterfaces;
 static unixctl_cb_func lacpd_unixctl_getlacpcounters;
 static unixctl_cb_func lacpd_unixctl_getlacpstate;
+static unixctl_cb_func lacpd_unixctl_threads;
 static unixctl_cb_func ops_lacpd_exit;
 
 extern int lacpd_shutdown;
 
+/* Scheduling settings for the LACPDU RX and protocol threads. */
+static int rt_policy = SCHED_OTHER;
+static int rt_priority = 0;
+static bool rt_mlockall = false;
+static bool rt_memory_locked = false;
+static cpu_set_t rt_protocol_cpus;
+static cpu_set_t rt_rx_cpus;
+static bool rt_protocol_cpus_set = false;
+static bool rt_rx_cpus_set = false;
+
+/* How often the main loop checks that the threads still run with the
+ * configured settings, in timer ticks (seconds). */
+#define RT_CHECK_INTERVAL   10
+
+/* A thread started with the settings above. */
+struct rt_thread {
+    char            name[16];
+    pthread_t       tid;
+    int             policy;         /* Configured policy */
+    int             priority;       /* Configured priority */
+    const cpu_set_t *cpus;          /* Configured CPUs, NULL if any */
+    bool            drifted;        /* Runs with other settings.  Used
+                                     * only by the main thread. */
+};
+
+/* Protects rt_n_threads.  Entries below it don't change. */
+static pthread_mutex_t rt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct rt_thread rt_threads[ML_MAX_SHARDS + 1];
+static int rt_n_threads = 0;
+
 /**
  * ovs-appctl interface callback function to dump internal debug information.
  * This top level debug dump function calls other functions to dump lacpd
@@ -164,6 +200,255 @@ lacpd_unixctl_getlacpstate(struct unixctl_conn *conn, int argc,
     ds_destroy(&ds);
 } /* lacpd_unixctl_getlacpstate */
 
+static const char *
+rt_policy_str(int policy)
+{
+    switch (policy) {
+    case SCHED_OTHER:   return "other";
+    case SCHED_FIFO:    return "fifo";
+    case SCHED_RR:      return "rr";
+    default:            return "???";
+    }
+} /* rt_policy_str */
+
+/**
+ * Parses a CPU list such as "2,4-7".
+ *
+ * @param s CPU list.
+ * @param cpus set to the CPUs in the list.
+ *
+ * @return true if s is a valid, non-empty list.
+ */
+static bool
+rt_parse_cpus(const char *s, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+
+    while (*s) {
+        char *end;
+        long first, last;
+
+        first = strtol(s, &end, 10);
+        if (end == s || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        last = first;
+        if (*end == '-') {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if (end == s || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+        }
+        for (; first <= last; first++) {
+            CPU_SET(first, cpus);
+        }
+
+        if (*end == ',') {
+            end++;
+        } else if (*end) {
+            return false;
+        }
+        s = end;
+    }
+
+    return CPU_COUNT(cpus) > 0;
+} /* rt_parse_cpus */
+
+static void
+rt_put_cpus(struct ds *ds, const cpu_set_t *cpus)
+{
+    const char *sep = "";
+    int cpu, last;
+
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, cpus)) {
+            continue;
+        }
+        for (last = cpu; last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus);
+             last++) {
+            continue;
+        }
+        ds_put_format(ds, "%s%d", sep, cpu);
+        if (last > cpu) {
+            ds_put_format(ds, "-%d", last);
+        }
+        sep = ",";
+        cpu = last;
+    }
+} /* rt_put_cpus */
+
+/**
+ * Describes the scheduling policy and CPUs a thread currently runs with.
+ *
+ * @return false if they differ from the configured ones.
+ */
+static bool
+rt_thread_describe(struct ds *ds, const struct rt_thread *t)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+    int policy;
+    bool match = true;
+
+    if (pthread_getschedparam(t->tid, &policy, &param)) {
+        ds_put_cstr(ds, "not running");
+        return false;
+    }
+    ds_put_format(ds, "policy %s", rt_policy_str(policy));
+    if (policy != SCHED_OTHER) {
+        ds_put_format(ds, " %d", param.sched_priority);
+    }
+    if (policy != t->policy
+        || (policy != SCHED_OTHER && param.sched_priority != t->priority)) {
+        match = false;
+    }
+
+    if (!pthread_getaffinity_np(t->tid, sizeof cpus, &cpus)) {
+        ds_put_cstr(ds, ", cpus ");
+        rt_put_cpus(ds, &cpus);
+        if (t->cpus && !CPU_EQUAL(&cpus, t->cpus)) {
+            match = false;
+        }
+    }
+
+    return match;
+} /* rt_thread_describe */
+
+/**
+ * Starts a thread with the configured scheduling policy, pinned to cpus
+ * unless it's NULL.  If lacpd isn't permitted to use the real-time
+ * policy, the thread runs with the default policy instead.
+ *
+ * @return 0 on success, otherwise the pthread_create() error.
+ */
+static int
+rt_thread_create(const char *name, void *(*start)(void *), void *arg,
+                 const cpu_set_t *cpus)
+{
+    struct rt_thread *t = &rt_threads[rt_n_threads];
+    struct sched_param param;
+    pthread_attr_t attr;
+    int rc;
+
+    memset(t, 0, sizeof *t);
+    pthread_attr_init(&attr);
+    if (rt_policy != SCHED_OTHER) {
+        memset(&param, 0, sizeof param);
+        param.sched_priority = rt_priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, rt_policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    if (cpus) {
+        pthread_attr_setaffinity_np(&attr, sizeof *cpus, cpus);
+    }
+
+    rc = pthread_create(&t->tid, &attr, start, arg);
+    if (rc == EPERM && rt_policy != SCHED_OTHER) {
+        VLOG_WARN("Not permitted to run %s with policy %s %d, "
+                  "using the default policy", name,
+                  rt_policy_str(rt_policy), rt_priority);
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(&t->tid, &attr, start, arg);
+        t->drifted = true;
+    }
+    pthread_attr_destroy(&attr);
+
+    if (rc) {
+        return rc;
+    }
+
+    ovs_strlcpy(t->name, name, sizeof t->name);
+    t->policy = rt_policy;
+    t->priority = rt_priority;
+    t->cpus = cpus;
+
+    pthread_mutex_lock(&rt_mutex);
+    rt_n_threads++;
+    pthread_mutex_unlock(&rt_mutex);
+
+    return 0;
+} /* rt_thread_create */
+
+/**
+ * Logs the settings each thread started with, then every
+ * RT_CHECK_INTERVAL seconds warns about a thread that no longer runs
+ * with the configured ones, e.g. after chrt or taskset, or when a
+ * real-time policy wasn't permitted.
+ */
+static void
+rt_check_threads(bool startup)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    int i;
+
+    for (i = 0; i < rt_n_threads; i++) {
+        struct rt_thread *t = &rt_threads[i];
+        bool match;
+
+        ds_clear(&ds);
+        match = rt_thread_describe(&ds, t);
+        if (startup) {
+            VLOG_INFO("%s runs with %s", t->name, ds_cstr(&ds));
+        } else if (!match && !t->drifted) {
+            VLOG_WARN("%s no longer runs with the configured settings, "
+                      "now %s", t->name, ds_cstr(&ds));
+        } else if (match && t->drifted) {
+            VLOG_INFO("%s runs with the configured settings again, %s",
+                      t->name, ds_cstr(&ds));
+        }
+        t->drifted = !match;
+    }
+
+    ds_destroy(&ds);
+} /* rt_check_threads */
+
+/**
+ * ovs-appctl interface callback function to dump the configured and
+ * current scheduling policy and CPUs of the LACPDU RX and protocol
+ * threads.
+ *
+ * @param conn connection to ovs-appctl interface.
+ * @param argc OVS_UNUSED
+ * @param argv OVS_UNUSED
+ * @param OVS_UNUSED aux argument not used.
+ */
+static void
+lacpd_unixctl_threads(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                      const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    int i, n;
+
+    pthread_mutex_lock(&rt_mutex);
+    n = rt_n_threads;
+    pthread_mutex_unlock(&rt_mutex);
+
+    ds_put_format(&ds, "memory_locked            : %s\n",
+                  rt_memory_locked ? "true" : "false");
+    for (i = 0; i < n; i++) {
+        const struct rt_thread *t = &rt_threads[i];
+
+        ds_put_format(&ds, "Thread %s:\n", t->name);
+        ds_put_format(&ds, "    configured           : policy %s",
+                      rt_policy_str(t->policy));
+        if (t->policy != SCHED_OTHER) {
+            ds_put_format(&ds, " %d", t->priority);
+        }
+        if (t->cpus) {
+            ds_put_cstr(&ds, ", cpus ");
+            rt_put_cpus(&ds, t->cpus);
+        }
+        ds_put_cstr(&ds, "\n    current              : ");
+        rt_thread_describe(&ds, t);
+        ds_put_cstr(&ds, "\n");
+    }
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+} /* lacpd_unixctl_threads */
+
 
 /**
  * callback handler function for diagnostic dump basic
@@ -224,7 +509,8 @@ timerHandler(void)
     memset(timerEvent, 0, sizeof(ML_event));
     timerEvent->sender.peer = ml_timer_index;
 
-    ml_send_event(timerEvent);
+    /* Every protocol shard runs its own ports' timers. */
+    ml_broadcast_event(timerEvent, sizeof(ML_event));
 } /* timerHandler */
 
 /**
@@ -237,24 +523,41 @@ static void
 lacpd_init(const char *db_path, struct unixctl_server *appctl)
 {
     int rc;
+    int shard;
+    char name[16];
     sigset_t sigset;
     pthread_t ovs_if_thread;
-    pthread_t lacpd_thread;
-    pthread_t lacpdu_rx_thread;
+    pthread_t appctl_thread;
 
     /* Block all signals so the spawned threads don't receive any. */
     sigemptyset(&sigset);
     sigfillset(&sigset);
     pthread_sigmask(SIG_BLOCK, &sigset, NULL);
 
-    /* Spawn off the main LACP protocol thread. */
-    rc = pthread_create(&lacpd_thread,
-                        (pthread_attr_t *)NULL,
-                        lacpd_protocol_thread,
-                        NULL);
-    if (rc) {
-        VLOG_ERR("pthread_create for LACPD protocol thread failed! rc=%d", rc);
-        exit(-rc);
+    /* Keep the protocol threads from page faulting under memory
+     * pressure.  This covers all memory mapped later, thread stacks
+     * included. */
+    if (rt_mlockall) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+            VLOG_ERR("mlockall failed: %s", strerror(errno));
+        } else {
+            rt_memory_locked = true;
+        }
+    }
+
+    /* Spawn off one LACP protocol thread per shard. */
+    for (shard = 0; shard < ml_n_shards; shard++) {
+        snprintf(name, sizeof name, "lacpd_proto%d", shard);
+        rc = rt_thread_create(name,
+                              lacpd_protocol_thread,
+                              (void *)(intptr_t)shard,
+                              rt_protocol_cpus_set ? &rt_protocol_cpus
+                                                   : NULL);
+        if (rc) {
+            VLOG_ERR("pthread_create for LACPD protocol thread %d failed! "
+                     "rc=%d", shard, rc);
+            exit(-rc);
+        }
     }
 
     /* Initialize IDL through a new connection to the dB. */
@@ -271,26 +574,39 @@ lacpd_init(const char *db_path, struct unixctl_server *appctl)
                              lacpd_unixctl_getlacpcounters, NULL);
     unixctl_command_register("lacpd/getlacpstate", "", 0, 1,
                              lacpd_unixctl_getlacpstate, NULL);
+    unixctl_command_register("lacpd/threads", "", 0, 0,
+                             lacpd_unixctl_threads, NULL);
 
     /* Spawn off the OVSDB interface thread. */
     rc = pthread_create(&ovs_if_thread,
                         (pthread_attr_t *)NULL,
                         lacpd_ovs_main_thread,
-                        (void *)appctl);
+                        NULL);
     if (rc) {
         VLOG_ERR("pthread_create for OVSDB i/f thread failed! rc=%d", rc);
         exit(-rc);
     }
 
-    /* Spawn off LACPDU RX thread. */
-    rc = pthread_create(&lacpdu_rx_thread,
+    /* Spawn off the ovs-appctl server thread. */
+    rc = pthread_create(&appctl_thread,
                         (pthread_attr_t *)NULL,
-                        mlacp_rx_pdu_thread,
-                        NULL);
+                        lacpd_appctl_thread,
+                        (void *)appctl);
+    if (rc) {
+        VLOG_ERR("pthread_create for appctl thread failed! rc=%d", rc);
+        exit(-rc);
+    }
+
+    /* Spawn off LACPDU RX thread. */
+    rc = rt_thread_create("lacpd_rx",
+                          mlacp_rx_pdu_thread,
+                          NULL,
+                          rt_rx_cpus_set ? &rt_rx_cpus : NULL);
     if (rc) {
         VLOG_ERR("pthread_create for LACDU RX thread failed! rc=%d", rc);
         exit(-rc);
     }
+    rt_check_threads(true);
 
     /* Init events for LACP. */
     if (event_log_init("LACP") < 0) {
@@ -315,7 +631,27 @@ usage(void)
     vlog_usage();
     printf("\nOther options:\n"
            "  --unixctl=SOCKET        override default control socket name\n"
-           "  -h, --help              display this help message\n");
+           "  --status-interval=MS    coalesce LACP status writes to OVSDB\n"
+           "                          over MS milliseconds (default: 50)\n"
+           "  --protocol-shards=N     run the LACP protocol on N threads,\n"
+           "                          each owning a share of the LAGs\n"
+           "                          (default: 1, max: %d)\n"
+           "  --rt-policy=fifo|rr     run the LACPDU RX and protocol threads\n"
+           "                          with a real-time scheduling policy\n"
+           "  --rt-priority=N         real-time priority of those threads\n"
+           "                          (default: lowest of the policy)\n"
+           "  --protocol-cpus=LIST    pin the protocol threads to the CPUs\n"
+           "                          in LIST, e.g. 2,4-7\n"
+           "  --rx-cpus=LIST          pin the LACPDU RX thread to the CPUs\n"
+           "                          in LIST\n"
+           "  --mlockall              lock all of lacpd's memory in RAM\n"
+           "  --netlink-link-state    take LACP members down as soon as the\n"
+           "                          kernel reports their link stopped\n"
+           "                          running, ahead of OVSDB\n"
+           "  --stall-threshold=MS    log protocol events that take longer\n"
+           "                          than MS milliseconds (default: %d)\n"
+           "  -h, --help              display this help message\n",
+           ML_MAX_SHARDS, ML_STALL_THRESHOLD_DEFAULT);
     exit(EXIT_SUCCESS);
 } /* usage */
 
@@ -324,12 +660,30 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
 {
     enum {
         OPT_UNIXCTL = UCHAR_MAX + 1,
+        OPT_STATUS_INTERVAL,
+        OPT_PROTOCOL_SHARDS,
+        OPT_RT_POLICY,
+        OPT_RT_PRIORITY,
+        OPT_PROTOCOL_CPUS,
+        OPT_RX_CPUS,
+        OPT_MLOCKALL,
+        OPT_STALL_THRESHOLD,
+        OPT_NETLINK_LINK_STATE,
         VLOG_OPTION_ENUMS,
         DAEMON_OPTION_ENUMS,
     };
     static const struct option long_options[] = {
         {"help",        no_argument, NULL, 'h'},
         {"unixctl",     required_argument, NULL, OPT_UNIXCTL},
+        {"status-interval", required_argument, NULL, OPT_STATUS_INTERVAL},
+        {"protocol-shards", required_argument, NULL, OPT_PROTOCOL_SHARDS},
+        {"rt-policy",   required_argument, NULL, OPT_RT_POLICY},
+        {"rt-priority", required_argument, NULL, OPT_RT_PRIORITY},
+        {"protocol-cpus", required_argument, NULL, OPT_PROTOCOL_CPUS},
+        {"rx-cpus",     required_argument, NULL, OPT_RX_CPUS},
+        {"mlockall",    no_argument, NULL, OPT_MLOCKALL},
+        {"stall-threshold", required_argument, NULL, OPT_STALL_THRESHOLD},
+        {"netlink-link-state", no_argument, NULL, OPT_NETLINK_LINK_STATE},
         DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         {NULL, 0, NULL, 0},
@@ -352,6 +706,61 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
             *unixctl_pathp = optarg;
             break;
 
+        case OPT_STATUS_INTERVAL:
+            lacpd_set_status_interval(atoi(optarg));
+            break;
+
+        case OPT_PROTOCOL_SHARDS:
+            if (ml_set_n_shards(atoi(optarg))) {
+                VLOG_FATAL("--protocol-shards must be between 1 and %d",
+                           ML_MAX_SHARDS);
+            }
+            break;
+
+        case OPT_RT_POLICY:
+            if (!strcmp(optarg, "fifo")) {
+                rt_policy = SCHED_FIFO;
+            } else if (!strcmp(optarg, "rr")) {
+                rt_policy = SCHED_RR;
+            } else {
+                VLOG_FATAL("--rt-policy must be fifo or rr");
+            }
+            break;
+
+        case OPT_RT_PRIORITY:
+            rt_priority = atoi(optarg);
+            break;
+
+        case OPT_PROTOCOL_CPUS:
+            if (!rt_parse_cpus(optarg, &rt_protocol_cpus)) {
+                VLOG_FATAL("invalid --protocol-cpus list \"%s\"", optarg);
+            }
+            rt_protocol_cpus_set = true;
+            break;
+
+        case OPT_RX_CPUS:
+            if (!rt_parse_cpus(optarg, &rt_rx_cpus)) {
+                VLOG_FATAL("invalid --rx-cpus list \"%s\"", optarg);
+            }
+            rt_rx_cpus_set = true;
+            break;
+
+        case OPT_MLOCKALL:
+            rt_mlockall = true;
+            break;
+
+        case OPT_STALL_THRESHOLD:
+            if (atoi(optarg) <= 0) {
+                VLOG_FATAL("--stall-threshold must be a positive number "
+                           "of milliseconds");
+            }
+            ml_set_stall_threshold(atoi(optarg));
+            break;
+
+        case OPT_NETLINK_LINK_STATE:
+            ml_enable_link_watch();
+            break;
+
         VLOG_OPTION_HANDLERS
         DAEMON_OPTION_HANDLERS
 
@@ -364,6 +773,19 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
     }
     free(short_options);
 
+    if (rt_policy == SCHED_OTHER) {
+        if (rt_priority) {
+            VLOG_FATAL("--rt-priority requires --rt-policy");
+        }
+    } else if (!rt_priority) {
+        rt_priority = sched_get_priority_min(rt_policy);
+    } else if (rt_priority < sched_get_priority_min(rt_policy)
+               || rt_priority > sched_get_priority_max(rt_policy)) {
+        VLOG_FATAL("--rt-priority must be between %d and %d",
+                   sched_get_priority_min(rt_policy),
+                   sched_get_priority_max(rt_policy));
+    }
+
     argc -= optind;
     argv += optind;
 
@@ -393,7 +815,9 @@ ops_lacpd_exit(struct unixctl_conn *conn, int argc OVS_UNUSED,
                  const char *argv[] OVS_UNUSED, void *exiting_)
 {
     bool *exiting = exiting_;
-    *exiting = true;
+
+    /* Read by the OVS thread. */
+    __atomic_store_n(exiting, true, __ATOMIC_RELEASE);
     unixctl_command_reply(conn, NULL);
 } /* ops_lacpd_exit */
 
@@ -416,6 +840,7 @@ main(int argc, char *argv[])
     int retval;
     sigset_t sigset;
     int signum;
+    int rt_ticks = 0;
 
     set_program_name(argv[0]);
     proctitle_init(argc, argv);
@@ -481,6 +906,10 @@ main(int argc, char *argv[])
 
         case SIGALRM:
             timerHandler();
+            if (++rt_ticks >= RT_CHECK_INTERVAL) {
+                rt_ticks = 0;
+                rt_check_threads(false);
+            }
             break;
 
         case SIGTERM:
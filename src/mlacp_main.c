@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 #include <unistd.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -31,8 +32,11 @@
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
 #include <linux/filter.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 #include <util.h>
+#include <timeval.h>
 #include <openvswitch/vlog.h>
 
 #include <mqueue.h>
@@ -54,12 +58,63 @@ VLOG_DEFINE_THIS_MODULE(mlacp_main);
 static int lacp_init_done = FALSE;
 int lacpd_shutdown = 0;
 
-/* Message Queue for LACPD main protocol thread */
-mqueue_t lacpd_main_rcvq;
+/* Protocol shards.  Shard N is run by the Nth protocol thread. */
+typedef struct ml_shard {
+    mqueue_t            rcvq;       /* Events for this shard */
+    unsigned long long  n_events;   /* Events processed so far */
+    pthread_mutex_t     stall_mutex;/* Protects stalls.worst[] */
+    ml_stall_stats_t    stalls;     /* Event handling times */
+    ml_effects_stats_t  effects;    /* Side effects of LACPDUs */
+} ml_shard_t;
+
+static ml_shard_t ml_shards[ML_MAX_SHARDS];
+int ml_n_shards = 1;
+
+/* Payload of a sync request, see ml_sync_shard(). */
+typedef struct ml_sync {
+    int                 port;       /* Interface index */
+    unsigned int        seq;        /* Handed back to lacpd_shard_synced() */
+} ml_sync_t;
+
+/* Most events a shard handles before it applies their side effects. */
+#define ML_EVENT_BATCH_MAX  64
+
+/* Events that take longer than this to handle are logged. */
+static long long ml_stall_threshold_us = ML_STALL_THRESHOLD_DEFAULT * 1000LL;
+
+/* Index of the shard the calling protocol thread runs. */
+__thread int ml_shard_id = 0;
 
 /* epoll FD for LACPDU RX. */
 int epfd = -1;
 
+/* Kernel link state watch.  When enabled, the RX thread also listens to
+ * rtnetlink link messages, and a member whose kernel link stops running
+ * is taken down in its shard ahead of everything queued there, without
+ * waiting for switchd to update link_state in OVSDB.  OVSDB remains the
+ * authority: when the kernel link runs again, the OVS thread is asked to
+ * resend the link state it has from OVSDB.  The RX thread doesn't own
+ * the interface data, so an entry keeps its own copy of what it needs. */
+typedef struct ml_link_watch {
+    int                 ifindex;    /* Kernel ifindex */
+    int                 port;       /* Interface index */
+    port_handle_t       lport_handle;
+    int                 shard;      /* Shard running the port */
+    char                name[IFNAMSIZ];
+    bool                running;    /* Last kernel IFF_RUNNING */
+    bool                fast_down;  /* Link down sent ahead of OVSDB */
+} ml_link_watch_t;
+
+static bool link_watch_enabled = false;
+static int nl_sockfd = -1;
+
+/* Protects the watch list and its statistics. */
+static pthread_mutex_t link_watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ml_link_watch_t *link_watch = NULL;
+static int link_watch_n = 0;
+static int link_watch_allocated = 0;
+static ml_link_watch_stats_t link_watch_stats;
+
 /* Max number of events returned by epoll_wait().
  * This number is arbitrary.  It's only used for
  * sizing the epoll events data structure. */
@@ -96,41 +151,166 @@ static struct sock_fprog lacpd_fprog = {
 /************************************************************************
  * Event Receiver Functions
  ************************************************************************/
+int
+ml_set_n_shards(int n_shards)
+{
+    if (lacp_init_done == TRUE ||
+        n_shards < 1 || n_shards > ML_MAX_SHARDS) {
+        return -1;
+    }
+
+    ml_n_shards = n_shards;
+
+    return 0;
+} /* ml_set_n_shards */
+
+/* All members of a LAG must be run by the LAG's shard. */
+int
+ml_lag_shard(int lag_id)
+{
+    return lag_id % ml_n_shards;
+} /* ml_lag_shard */
+
 int
 ml_init_event_rcvr(void)
+{
+    int rc;
+    int shard;
+
+    for (shard = 0; shard < ml_n_shards; shard++) {
+        rc = mqueue_init(&ml_shards[shard].rcvq);
+        if (rc) {
+            VLOG_ERR("Failed LACP shard %d receive queue init: %s",
+                     shard, strerror(rc));
+            return rc;
+        }
+        pthread_mutex_init(&ml_shards[shard].stall_mutex, NULL);
+    }
+
+    return 0;
+} /* ml_init_event_rcvr */
+
+/* Returns true if the queued event is a link state change of the port
+ * whose link state change 'event' is. */
+static bool
+ml_event_supersedes(const void *event_, const void *queued_)
+{
+    const ML_event *event = event_;
+    const ML_event *queued = queued_;
+
+    if (queued->sender.peer != ml_lport_index ||
+        (queued->msgnum != MLm_vpm_api__lport_state_up &&
+         queued->msgnum != MLm_vpm_api__lport_state_down)) {
+        return false;
+    }
+
+    /* The msg pointers are only set up by the receiver. */
+    return (((const struct MLt_vpm_api__lport_state_change *)(queued+1))
+            ->lport_handle ==
+            ((const struct MLt_vpm_api__lport_state_change *)(event+1))
+            ->lport_handle);
+} /* ml_event_supersedes */
+
+static void
+ml_event_drop(void *event)
+{
+    ml_event_free(event);
+} /* ml_event_drop */
+
+/* Sends a link state change ahead of everything already queued for the
+ * shard.  The link state changes of the same port still queued are
+ * older, so they are dropped rather than overtaken. */
+int
+ml_send_urgent_event(int shard, ML_event *event)
 {
     int rc;
 
-    rc = mqueue_init(&lacpd_main_rcvq);
+    rc = mqueue_send_urgent_superseding(&ml_shards[shard].rcvq, event,
+                                        ml_event_supersedes, ml_event_drop);
     if (rc) {
-        VLOG_ERR("Failed LACP main receive queue init: %s",
-                 strerror(rc));
+        VLOG_ERR("Failed to send to LACP shard %d receive queue: %s",
+                 shard, strerror(rc));
     }
 
     return rc;
-} /* ml_init_event_rcvr */
+} /* ml_send_urgent_event */
 
 int
-ml_send_event(ML_event *event)
+ml_send_event(int shard, ML_event *event)
 {
     int rc;
 
-    rc = mqueue_send(&lacpd_main_rcvq, event);
+    rc = mqueue_send(&ml_shards[shard].rcvq, event);
     if (rc) {
-        VLOG_ERR("Failed to send to LACP main receive queue: %s",
-                 strerror(rc));
+        VLOG_ERR("Failed to send to LACP shard %d receive queue: %s",
+                 shard, strerror(rc));
     }
 
     return rc;
 } /* ml_send_event */
 
+/* Sends the event to every shard.  The other shards get copies of the
+ * first size bytes, so the message must follow the event structure. */
+int
+ml_broadcast_event(ML_event *event, int size)
+{
+    int rc = 0;
+    int shard;
+
+    for (shard = 1; shard < ml_n_shards; shard++) {
+        ML_event *copy = malloc(size);
+
+        if (copy == NULL) {
+            VLOG_ERR("Out of memory for LACP shard %d message.", shard);
+            rc = ENOMEM;
+            continue;
+        }
+        memcpy(copy, event, size);
+        if (ml_send_event(shard, copy)) {
+            free(copy);
+            rc = -1;
+        }
+    }
+
+    if (ml_send_event(0, event)) {
+        free(event);
+        rc = -1;
+    }
+
+    return rc;
+} /* ml_broadcast_event */
+
+/* Asks the shard to call lacpd_shard_synced(port, seq) once it has
+ * handled everything queued for it so far and sent out the side
+ * effects.  Doesn't wait for it. */
+int
+ml_sync_shard(int shard, int port, unsigned int seq)
+{
+    ML_event *event;
+    ml_sync_t *sync;
+    int rc;
+
+    event = xzalloc(sizeof(ML_event) + sizeof(ml_sync_t));
+    event->sender.peer = ml_sync_index;
+    sync = (ml_sync_t *)(event+1);
+    sync->port = port;
+    sync->seq = seq;
+
+    rc = ml_send_event(shard, event);
+    if (rc) {
+        free(event);
+    }
+
+    return rc;
+} /* ml_sync_shard */
+
 ML_event *
 ml_wait_for_next_event(void)
 {
     int rc;
     ML_event *event = NULL;
 
-    rc = mqueue_wait(&lacpd_main_rcvq, (void **)(void *)&event);
+    rc = mqueue_wait(&ml_shards[ml_shard_id].rcvq, (void **)(void *)&event);
     if (!rc) {
         /* Set up event->msg pointer to just after the event
          * structure itself. This must be done here since the
@@ -140,13 +320,28 @@ ml_wait_for_next_event(void)
          */
         event->msg = (void *)(event+1);
     } else {
-        VLOG_ERR("LACP main receive queue wait error, rc=%s",
-                 strerror(rc));
+        VLOG_ERR("LACP shard %d receive queue wait error, rc=%s",
+                 ml_shard_id, strerror(rc));
     }
 
     return event;
 } /* ml_wait_for_next_event */
 
+/* Returns the next queued event, or NULL if there is none. */
+ML_event *
+ml_poll_next_event(void)
+{
+    ML_event *event = NULL;
+
+    if (mqueue_trywait(&ml_shards[ml_shard_id].rcvq,
+                       (void **)(void *)&event)) {
+        return NULL;
+    }
+    event->msg = (void *)(event+1);
+
+    return event;
+} /* ml_poll_next_event */
+
 void
 ml_event_free(ML_event *event)
 {
@@ -155,6 +350,388 @@ ml_event_free(ML_event *event)
     }
 } /* ml_event_free */
 
+unsigned long long
+ml_shard_n_events(int shard)
+{
+    return ml_shards[shard].n_events;
+} /* ml_shard_n_events */
+
+void
+ml_shard_effects_stats(int shard, ml_effects_stats_t *stats)
+{
+    *stats = ml_shards[shard].effects;
+} /* ml_shard_effects_stats */
+
+/* Called from the protocol thread when all members of a LAG distribute. */
+void
+ml_record_lag_bringup(long long msec)
+{
+    ml_effects_stats_t *effects = &ml_shards[ml_shard_id].effects;
+
+    effects->n_bringups++;
+    effects->last_bringup = msec;
+    if (msec > effects->max_bringup) {
+        effects->max_bringup = msec;
+    }
+} /* ml_record_lag_bringup */
+
+/************************************************************************
+ * Event Handling Times
+ ************************************************************************/
+void
+ml_set_stall_threshold(int msec)
+{
+    if (msec > 0) {
+        ml_stall_threshold_us = msec * 1000LL;
+    }
+} /* ml_set_stall_threshold */
+
+int
+ml_stall_threshold(void)
+{
+    return (int)(ml_stall_threshold_us / 1000);
+} /* ml_stall_threshold */
+
+/* Copies a shard's handling time histogram and slowest events. */
+void
+ml_shard_stall_stats(int shard, ml_stall_stats_t *stats)
+{
+    pthread_mutex_lock(&ml_shards[shard].stall_mutex);
+    *stats = ml_shards[shard].stalls;
+    pthread_mutex_unlock(&ml_shards[shard].stall_mutex);
+} /* ml_shard_stall_stats */
+
+const char *
+ml_event_name(int peer, int msgnum)
+{
+    if (peer == ml_timer_index) {
+        return "timer";
+    } else if (peer == ml_rx_pdu_index) {
+        return "lacpdu";
+    } else if (peer == ml_sync_index) {
+        return "sync";
+    }
+
+    switch (msgnum) {
+    case MLm_lacp_api__setActorSysPriority:         return "set_sys_priority";
+    case MLm_lacp_api__setActorSysMac:              return "set_sys_mac";
+    case MLm_lacp_api__set_lport_overrides:         return "set_lport_overrides";
+    case MLm_vpm_api__create_sport:                 return "create_sport";
+    case MLm_vpm_api__delete_sport:                 return "delete_sport";
+    case MLm_vpm_api__lport_state_up:               return "lport_state_up";
+    case MLm_vpm_api__lport_state_down:             return "lport_state_down";
+    case MLm_vpm_api__set_lacp_sport_params:        return "set_sport_params";
+    case MLm_vpm_api__unset_lacp_sport_params:      return "unset_sport_params";
+    case MLm_vpm_api__set_lacp_lport_params_event:  return "set_lport_params";
+    case MLm_vpm_api__set_lport_fallback_status:    return "set_lport_fallback";
+    default:                                        return "unknown";
+    }
+} /* ml_event_name */
+
+/* Finds the port or LAG an event is about. */
+static void
+ml_event_subject(const ML_event *event, int *port, int *lag_id)
+{
+    port_handle_t lport = 0;
+    port_handle_t sport = 0;
+
+    if (event->sender.peer == ml_rx_pdu_index) {
+        lport = ((struct MLt_drivers_mlacp__rxPdu *)event->msg)->lport_handle;
+    } else if (event->sender.peer != ml_timer_index &&
+               event->sender.peer != ml_sync_index) {
+        switch (event->msgnum) {
+        case MLm_lacp_api__set_lport_overrides:
+            lport = ((struct MLt_lacp_api__set_lport_overrides *)
+                     event->msg)->lport_handle;
+            break;
+        case MLm_vpm_api__lport_state_up:
+        case MLm_vpm_api__lport_state_down:
+            lport = ((struct MLt_vpm_api__lport_state_change *)
+                     event->msg)->lport_handle;
+            break;
+        case MLm_vpm_api__set_lacp_lport_params_event:
+            lport = ((struct MLt_vpm_api__lport_lacp_change *)
+                     event->msg)->lport_handle;
+            break;
+        case MLm_vpm_api__set_lport_fallback_status:
+            lport = ((struct MLt_vpm_api__lport_fallback_status *)
+                     event->msg)->lport_handle;
+            break;
+        case MLm_vpm_api__create_sport:
+            sport = ((struct MLt_vpm_api__create_sport *)event->msg)->handle;
+            break;
+        case MLm_vpm_api__delete_sport:
+            sport = ((struct MLt_vpm_api__delete_sport *)event->msg)->handle;
+            break;
+        case MLm_vpm_api__set_lacp_sport_params:
+        case MLm_vpm_api__unset_lacp_sport_params:
+            sport = ((struct MLt_vpm_api__lacp_sport_params *)
+                     event->msg)->sport_handle;
+            break;
+        default:
+            break;
+        }
+    }
+
+    *port = lport ? PM_HANDLE2PORT(lport) : -1;
+    *lag_id = sport ? (int)PM_HANDLE2LAG(sport) : -1;
+} /* ml_event_subject */
+
+/* Records how long the calling shard took to handle an event, and logs
+ * the event if it took longer than the stall threshold.  Only the
+ * slowest events so far take the stats lock. */
+static void
+ml_record_event_time(const ML_event *event, long long duration)
+{
+    static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+    ml_shard_t *shard = &ml_shards[ml_shard_id];
+    ml_stall_stats_t *stats = &shard->stalls;
+    ml_stall_t stall;
+    bool worst;
+    int bucket;
+    int i;
+
+    for (bucket = 0;
+         bucket < ML_STALL_BUCKETS - 1 && duration >= (1LL << bucket);
+         bucket++) {
+        continue;
+    }
+    stats->hist[bucket]++;
+
+    worst = (stats->n_worst < ML_STALL_WORST
+             || duration > stats->worst[ML_STALL_WORST - 1].duration);
+    if (!worst && duration < ml_stall_threshold_us) {
+        return;
+    }
+
+    stall.duration = duration;
+    stall.when = time_wall_msec();
+    stall.peer = event->sender.peer;
+    stall.msgnum = event->msgnum;
+    ml_event_subject(event, &stall.port, &stall.lag_id);
+
+    if (duration >= ml_stall_threshold_us) {
+        VLOG_WARN_RL(&rl, "LACP shard %d took %lld ms to handle a %s event "
+                     "(port %d, LAG %d)", ml_shard_id, duration / 1000,
+                     ml_event_name(stall.peer, stall.msgnum),
+                     stall.port, stall.lag_id);
+    }
+
+    if (worst) {
+        pthread_mutex_lock(&shard->stall_mutex);
+        if (stats->n_worst < ML_STALL_WORST) {
+            stats->n_worst++;
+        }
+        for (i = stats->n_worst - 1;
+             i > 0 && stats->worst[i - 1].duration < duration; i--) {
+            stats->worst[i] = stats->worst[i - 1];
+        }
+        stats->worst[i] = stall;
+        pthread_mutex_unlock(&shard->stall_mutex);
+    }
+} /* ml_record_event_time */
+
+/************************************************************************
+ * Kernel Link State Watch
+ ************************************************************************/
+void
+ml_enable_link_watch(void)
+{
+    link_watch_enabled = true;
+} /* ml_enable_link_watch */
+
+void
+ml_link_watch_get_stats(ml_link_watch_stats_t *stats)
+{
+    pthread_mutex_lock(&link_watch_mutex);
+    *stats = link_watch_stats;
+    stats->enabled = link_watch_enabled;
+    stats->n_watched = link_watch_n;
+    pthread_mutex_unlock(&link_watch_mutex);
+} /* ml_link_watch_get_stats */
+
+/* Called from the protocol thread running the port. */
+static void
+link_watch_add(int ifindex, port_handle_t lport_handle, const char *name)
+{
+    ml_link_watch_t *watch;
+
+    if (!link_watch_enabled) {
+        return;
+    }
+
+    pthread_mutex_lock(&link_watch_mutex);
+    if (link_watch_n == link_watch_allocated) {
+        link_watch_allocated = (link_watch_allocated
+                                ? 2 * link_watch_allocated : 64);
+        link_watch = xrealloc(link_watch,
+                              link_watch_allocated * sizeof *link_watch);
+    }
+    watch = &link_watch[link_watch_n++];
+    watch->ifindex = ifindex;
+    watch->port = PM_HANDLE2PORT(lport_handle);
+    watch->lport_handle = lport_handle;
+    watch->shard = ml_shard_id;
+    ovs_strlcpy(watch->name, name, sizeof watch->name);
+    watch->running = true;
+    watch->fast_down = false;
+    pthread_mutex_unlock(&link_watch_mutex);
+} /* link_watch_add */
+
+/* Stops watching interface index 'port'.  Called when the port stops
+ * running LACP, and when the interface is deleted. */
+void
+ml_link_watch_remove(int port)
+{
+    int i;
+
+    if (!link_watch_enabled) {
+        return;
+    }
+
+    pthread_mutex_lock(&link_watch_mutex);
+    for (i = 0; i < link_watch_n; i++) {
+        if (link_watch[i].port == port) {
+            link_watch[i] = link_watch[--link_watch_n];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&link_watch_mutex);
+} /* ml_link_watch_remove */
+
+/* Takes the port down in its shard ahead of the queued events.  Called
+ * with link_watch_mutex held. */
+static void
+link_watch_send_down(const ml_link_watch_t *watch)
+{
+    struct MLt_vpm_api__lport_state_change *msg;
+    ML_event *event;
+
+    event = xzalloc(sizeof(ML_event) +
+                    sizeof(struct MLt_vpm_api__lport_state_change));
+    event->sender.peer = ml_lport_index;
+    event->msgnum = MLm_vpm_api__lport_state_down;
+
+    msg = (struct MLt_vpm_api__lport_state_change *)(event+1);
+    msg->lport_handle = watch->lport_handle;
+
+    if (ml_send_urgent_event(watch->shard, event)) {
+        free(event);
+    }
+} /* link_watch_send_down */
+
+static void
+link_watch_update(int ifindex, bool running)
+{
+    ml_link_watch_t *watch = NULL;
+    int i;
+
+    pthread_mutex_lock(&link_watch_mutex);
+    for (i = 0; i < link_watch_n; i++) {
+        if (link_watch[i].ifindex == ifindex) {
+            watch = &link_watch[i];
+            break;
+        }
+    }
+
+    if (watch && watch->running != running) {
+        watch->running = running;
+        if (!running) {
+            VLOG_DBG("Kernel link of %s stopped running", watch->name);
+            lacpd_fast_tx_disable(watch->name, watch->port);
+            link_watch_send_down(watch);
+            watch->fast_down = true;
+            link_watch_stats.n_fast_down++;
+        } else if (watch->fast_down) {
+            VLOG_DBG("Kernel link of %s runs again", watch->name);
+            lacpd_link_state_resync(watch->port);
+            watch->fast_down = false;
+            link_watch_stats.n_resync++;
+        }
+    }
+    pthread_mutex_unlock(&link_watch_mutex);
+} /* link_watch_update */
+
+static int
+link_watch_open(void)
+{
+    struct sockaddr_nl addr;
+    struct epoll_event event;
+    int sockfd;
+
+    sockfd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (sockfd < 0) {
+        VLOG_ERR("Failed to open rtnetlink socket, rc=%s", strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        VLOG_ERR("Failed to bind rtnetlink socket, rc=%s", strerror(errno));
+        close(sockfd);
+        return -1;
+    }
+
+    /* The RX loop tells this socket from the LACPDU sockets by its
+     * event data. */
+    event.events = EPOLLIN;
+    event.data.ptr = (void *)&nl_sockfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &event) < 0) {
+        VLOG_ERR("Failed to register rtnetlink socket with epoll loop.  "
+                 "err=%s", strerror(errno));
+        close(sockfd);
+        return -1;
+    }
+
+    return sockfd;
+} /* link_watch_open */
+
+/* Reads all the pending rtnetlink messages. */
+static void
+link_watch_run(void)
+{
+    char buf[8192] __attribute__ ((aligned(NLMSG_ALIGNTO)));
+
+    for (;;) {
+        struct nlmsghdr *nlh;
+        int len;
+
+        len = recv(nl_sockfd, buf, sizeof buf, 0);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                /* Messages were lost.  OVSDB still has the link state. */
+                VLOG_WARN("rtnetlink socket overrun, link changes lost");
+                continue;
+            }
+            if (errno != EAGAIN && errno != EINTR) {
+                VLOG_ERR("rtnetlink read failed, rc=%s", strerror(errno));
+            }
+            return;
+        }
+
+        for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            struct ifinfomsg *ifi;
+
+            if (nlh->nlmsg_type != RTM_NEWLINK
+                && nlh->nlmsg_type != RTM_DELLINK) {
+                continue;
+            }
+
+            ifi = NLMSG_DATA(nlh);
+            pthread_mutex_lock(&link_watch_mutex);
+            link_watch_stats.n_events++;
+            pthread_mutex_unlock(&link_watch_mutex);
+
+            link_watch_update(ifi->ifi_index,
+                              (nlh->nlmsg_type == RTM_NEWLINK
+                               && (ifi->ifi_flags & IFF_RUNNING)));
+        }
+    }
+} /* link_watch_run */
+
 /************************************************************************
  * LACPDU Send and Receive Functions
  ************************************************************************/
@@ -170,6 +747,10 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
         return NULL;
     }
 
+    if (link_watch_enabled) {
+        nl_sockfd = link_watch_open();
+    }
+
     for (;;) {
         int n;
         int nfds;
@@ -193,6 +774,12 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
             int total_msg_size;
             struct MLt_drivers_mlacp__rxPdu *pkt_event;
             struct iface_data *idp = NULL;
+            int shard;
+
+            if (events[n].data.ptr == (void *)&nl_sockfd) {
+                link_watch_run();
+                continue;
+            }
 
             idp = (struct iface_data *)events[n].data.ptr;
             if (idp == NULL) {
@@ -208,6 +795,12 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
                 continue;
             }
 
+            /* The packet goes to the shard running LACP on the port. */
+            shard = __atomic_load_n(&idp->proto_shard, __ATOMIC_ACQUIRE);
+            if (shard < 0) {
+                continue;
+            }
+
             /* LACPDU size hard-coded to 124 max.
              * See MLt_drivers_mlacp__rxPdu in mlacp_recv.h
              */
@@ -246,7 +839,7 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
                 pkt_event->lport_handle = PM_SMPT2HANDLE(0, 0, idp->index,
                                                          idp->cycl_port_type);
                 pkt_event->pktLen = count;
-                ml_send_event(event);
+                ml_send_event(shard, event);
             }
         } /* for nfds */
     } /* for(;;) */
@@ -345,6 +938,7 @@ register_mcast_addr(port_handle_t lport_handle)
     /* Save sockfd information in interface data. */
     idp->pdu_sockfd = sockfd;
     idp->pdu_registered = true;
+    link_watch_add(if_idx, lport_handle, idp->name);
 
     /* Add new FD to epoll.  Save interface data pointer.
      * NOTE: assumption is that interfaces are not deleted in h/w switch! */
@@ -396,6 +990,7 @@ deregister_mcast_addr(port_handle_t lport_handle)
                  "loop.  err=%s", idp->name, strerror(errno));
     }
 
+    ml_link_watch_remove(port);
     close(idp->pdu_sockfd);
     idp->pdu_sockfd = 0;
     idp->pdu_registered = false;
@@ -451,21 +1046,35 @@ mlacp_tx_pdu(unsigned char* data, int length, port_handle_t lport_handle)
  * LACP Protocol Thread
  ************************************************************************/
 void *
-lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
+lacpd_protocol_thread(void *arg)
 {
-    ML_event *pevent;
+    ML_event *pevent = NULL;
+    ML_event *next;
+    long long start;
+    int n_requested, n_applied;
+    int batch_n = 0;
+    int batch_n_pdus = 0;
 
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
 
-    VLOG_DBG("%s : waiting for events in the main loop", __FUNCTION__);
+    /* Initialize this shard's super ports and LACP data structures. */
+    ml_shard_id = (int)(intptr_t)arg;
+    mvlan_sport_init(TRUE);
+    LACP_AVL_INIT_TREE(lacp_per_port_vars_tree, lacp_compare_port_handle);
+    LAG_pool_init();
+
+    VLOG_DBG("%s : shard %d waiting for events in the main loop",
+             __FUNCTION__, ml_shard_id);
 
     /*******************************************************************
      * The main receive loop.
      *******************************************************************/
     while (1) {
 
-        pevent = ml_wait_for_next_event();
+        if (pevent == NULL) {
+            pevent = ml_wait_for_next_event();
+        }
 
         if (lacpd_shutdown) {
             break;
@@ -476,6 +1085,15 @@ lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
             continue;
         }
 
+        ml_shards[ml_shard_id].n_events++;
+        start = time_usec();
+
+        /* The state machines' side effects are applied once the batch
+         * of events has been handled. */
+        if (batch_n++ == 0) {
+            LACP_effects_begin();
+        }
+
         if (pevent->sender.peer == ml_lport_index) {
             /***********************************************************
              * Msg from OVSDB interface for lports.
@@ -498,10 +1116,19 @@ lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
             /***********************************************************
              * Packet has arrived through interface socket.
              ************************************************************/
+            struct MLt_drivers_mlacp__rxPdu *pkt_event = pevent->msg;
+
             VLOG_DBG("%s : LACPDU Packet (%d) arrived from interface socket",
                    __FUNCTION__, pevent->msgnum);
 
+            LACP_effects_pdu_received(pkt_event->lport_handle);
             mlacp_process_rx_pdu(pevent);
+            batch_n_pdus++;
+
+        } else if (pevent->sender.peer == ml_sync_index) {
+            /***********************************************************
+             * Sync request, answered once the batch's effects are out.
+             ***********************************************************/
 
         } else {
             /***********************************************************
@@ -511,7 +1138,52 @@ lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
                      __FUNCTION__, pevent->msgnum, pevent->sender.peer);
         }
 
+        /* Publish what the event changed for the dumps.  A LACPDU only
+         * changes its port's LAG; the timer and configuration may change
+         * any port of the shard. */
+        if (pevent->sender.peer == ml_rx_pdu_index) {
+            struct MLt_drivers_mlacp__rxPdu *pkt_event = pevent->msg;
+
+            LACP_publish_port_lag(pkt_event->lport_handle);
+        } else if (pevent->sender.peer != ml_sync_index) {
+            LACP_publish_all_ports();
+        }
+
+        /* Keep deferring the side effects while more events are queued,
+         * so the members of a LAG that become ready in the same burst of
+         * LACPDUs and timer ticks are attached and enabled in the same
+         * transaction. */
+        next = NULL;
+        if (batch_n < ML_EVENT_BATCH_MAX &&
+            pevent->sender.peer != ml_sync_index) {
+            next = ml_poll_next_event();
+        }
+
+        if (next == NULL) {
+            LACP_effects_apply(&n_requested, &n_applied);
+
+            /* Only batches of LACPDUs count towards the updates per
+             * LACPDU. */
+            if (batch_n_pdus == batch_n) {
+                ml_effects_stats_t *effects = &ml_shards[ml_shard_id].effects;
+
+                effects->n_pdus += batch_n_pdus;
+                effects->n_requested += n_requested;
+                effects->n_applied += n_applied;
+            }
+            batch_n = 0;
+            batch_n_pdus = 0;
+        }
+
+        if (pevent->sender.peer == ml_sync_index) {
+            ml_sync_t *sync = pevent->msg;
+
+            lacpd_shard_synced(sync->port, sync->seq);
+        }
+
+        ml_record_event_time(pevent, time_usec() - start);
         ml_event_free(pevent);
+        pevent = next;
 
     } /* while loop */
 
@@ -538,13 +1210,9 @@ mlacp_init(u_long  first_time)
         goto end;
     }
 
-    /* Initialize super ports. */
-    mvlan_sport_init(first_time);
-
-    /* Initialize LACP data structures. */
-    LACP_AVL_INIT_TREE(lacp_per_port_vars_tree, lacp_compare_port_handle);
-
-    /* Initialize LACP main task event receiver queue. */
+    /* Super ports and LACP data structures are initialized by each
+     * protocol shard when its thread starts.  Initialize the shards'
+     * event receiver queues. */
     if (ml_init_event_rcvr()) {
         VLOG_ERR("Failed to initialize event receiver.");
         status = -1;
@@ -108,7 +108,7 @@ mlacp_blocking_send_select_aggregator(LAG_t *const lag,
     status = mvlan_api_select_aggregator(&match_params);
 
     if (R_SUCCESS == status) {
-        lacp_port->sport_handle = match_params.sport_handle;
+        LACP_set_sport_handle(lacp_port, match_params.sport_handle);
 
         if (lacp_port->debug_level & DBG_LACP_SEND) {
             RDBG("%s : Got matching aggr from MVPM "
@@ -194,7 +194,6 @@ mlacp_blocking_send_detach_aggregator(lacp_per_port_variables_t *lacp_port)
 int
 mlacp_blocking_send_enable_collecting(lacp_per_port_variables_t *lacp_port)
 {
-    int port;
     int lag_id;
     int status = R_SUCCESS;
 
@@ -203,7 +202,6 @@ mlacp_blocking_send_enable_collecting(lacp_per_port_variables_t *lacp_port)
     if (FALSE == lacp_port->hw_attached_to_mux) {
 
         lag_id = (int)PM_HANDLE2LAG(lacp_port->sport_handle);
-        port = (int)PM_HANDLE2PORT(lacp_port->lport_handle);
 
         //--- OPS_TODO: enable attach for now since STP is not running... ---
         //---------------------------------------------------------------
@@ -213,11 +211,9 @@ mlacp_blocking_send_enable_collecting(lacp_per_port_variables_t *lacp_port)
         // conditions or missed transient state transitions.
         //---------------------------------------------------------------
 
-        // Add the port to a trunk in hardware
-        ops_attach_port_in_hw(lag_id, port);
-
-        // Update DB with new info.
-        db_add_lag_port(lag_id, port, lacp_port);
+        // Add the port to a trunk in hardware and update DB with new
+        // info, once the event has been handled.
+        LACP_effect_attach(lacp_port, lag_id);
 
         // Set indicator.
         lacp_port->hw_attached_to_mux = TRUE;
@@ -229,17 +225,12 @@ mlacp_blocking_send_enable_collecting(lacp_per_port_variables_t *lacp_port)
 int
 mlacp_blocking_send_enable_distributing(lacp_per_port_variables_t *lacp_port)
 {
-    int port;
-    int lag_id;
     int status = R_SUCCESS;
 
     if (TRUE == lacp_port->hw_attached_to_mux) {
 
         // OpenSwitch: Take out egress disable flag from trunk member port flags.
-        lag_id = (int)PM_HANDLE2LAG(lacp_port->sport_handle);
-        port = (int)PM_HANDLE2PORT(lacp_port->lport_handle);
-
-        ops_trunk_port_egr_enable(lag_id, port);
+        LACP_effect_egress_enable(lacp_port);
     }
 
     return status;
@@ -248,17 +239,12 @@ mlacp_blocking_send_enable_distributing(lacp_per_port_variables_t *lacp_port)
 int
 mlacp_blocking_send_disable_collect_dist(lacp_per_port_variables_t *lacp_port)
 {
-    int port;
-    int lag_id;
     int status = R_SUCCESS;
 
     // OpenSwitch: Remove the port from trunk in hardware
     //          only if it wasn't already done.
     if (TRUE == lacp_port->hw_attached_to_mux) {
 
-        lag_id = (int)PM_HANDLE2LAG(lacp_port->sport_handle);
-        port = (int)PM_HANDLE2PORT(lacp_port->lport_handle);
-
         //--- OPS_TODO: enable attach for now since STP is not running... ---
         //---------------------------------------------------------------
         // NOTE: lacpd is no longer responsible for attaching/detaching
@@ -267,11 +253,9 @@ mlacp_blocking_send_disable_collect_dist(lacp_per_port_variables_t *lacp_port)
         // conditions or missed transient state transitions.
         //---------------------------------------------------------------
 
-        // Detach the port from LAG in h/w
-        ops_detach_port_in_hw(lag_id, port);
-
-        // Update DB with new info.
-        db_delete_lag_port(lag_id, port, lacp_port);
+        // Detach the port from LAG in h/w and update DB with new info,
+        // once the event has been handled.
+        LACP_effect_detach(lacp_port);
 
         // Clear out indicator.
         lacp_port->hw_collecting = FALSE;
@@ -22,6 +22,7 @@
  *
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <errno.h>
 
@@ -48,10 +49,66 @@ mqueue_init(mqueue_t *queue)
 
 } // mqueue_init
 
+static int
+mqueue_insert(mqueue_t *queue, void *data, bool urgent)
+{
+    qelem_t *new_elem;
+
+    if ((NULL == queue) || (NULL == data)) {
+        return EINVAL;
+    }
+
+    if ((new_elem = (qelem_t *) malloc(sizeof(qelem_t))) == NULL) {
+        return ENOMEM;
+    }
+
+    new_elem->q_data = data;
+
+    pthread_mutex_lock(&(queue->q_mutex));
+    if (urgent) {
+        insque(new_elem, &(queue->q_head));
+    } else {
+        insque(new_elem, queue->q_tail.q_back);
+    }
+
+    if (sem_post(&(queue->q_avail)) != 0) {
+        pthread_mutex_unlock(&(queue->q_mutex));
+        return errno;
+    }
+    pthread_mutex_unlock(&(queue->q_mutex));
+
+    return 0;
+
+} // mqueue_insert
+
 int
 mqueue_send(mqueue_t *queue, void* data)
+{
+    return mqueue_insert(queue, data, false);
+
+} // mqueue_send
+
+// Queues data ahead of everything already waiting in the queue.
+int
+mqueue_send_urgent(mqueue_t *queue, void* data)
+{
+    return mqueue_insert(queue, data, true);
+
+} // mqueue_send_urgent
+
+// Like mqueue_send_urgent(), but first drops the queued data that
+// supersedes(data, queued) says the new data replaces.  The dropped data
+// is passed to drop().
+int
+mqueue_send_urgent_superseding(mqueue_t *queue, void *data,
+                               bool (*supersedes)(const void *data,
+                                                  const void *queued),
+                               void (*drop)(void *queued))
 {
     qelem_t *new_elem;
+    qelem_t *elem;
+    qelem_t *next;
+    int n_dropped = 0;
 
     if ((NULL == queue) || (NULL == data)) {
         return EINVAL;
@@ -64,17 +121,33 @@ mqueue_send(mqueue_t *queue, void* data)
     new_elem->q_data = data;
 
     pthread_mutex_lock(&(queue->q_mutex));
-    insque(new_elem, queue->q_tail.q_back);
+    for (elem = queue->q_head.q_forw; elem != &(queue->q_tail); elem = next) {
+        next = elem->q_forw;
+        if (supersedes(data, elem->q_data)) {
+            remque(elem);
+            drop(elem->q_data);
+            free(elem);
+            n_dropped++;
+        }
+    }
+    insque(new_elem, &(queue->q_head));
 
+    // Post for the new element before taking back the counts of the
+    // dropped ones.  A receiver that already took a count is waiting for
+    // the mutex and gets at least the new element, so there are always
+    // enough counts left to take back.
     if (sem_post(&(queue->q_avail)) != 0) {
         pthread_mutex_unlock(&(queue->q_mutex));
         return errno;
     }
+    while (n_dropped-- > 0) {
+        sem_trywait(&(queue->q_avail));
+    }
     pthread_mutex_unlock(&(queue->q_mutex));
 
     return 0;
 
-} // mqueue_send
+} // mqueue_send_urgent_superseding
 
 int
 mqueue_wait(mqueue_t *queue, void **data)
@@ -100,3 +173,31 @@ mqueue_wait(mqueue_t *queue, void **data)
     return 0;
 
 } // mqueue_wait
+
+// Like mqueue_wait(), but returns EAGAIN instead of blocking when the
+// queue is empty.
+int
+mqueue_trywait(mqueue_t *queue, void **data)
+{
+    qelem_t *new_elem;
+
+    if ((NULL == queue) || (NULL == data)) {
+        return EINVAL;
+    }
+
+    if (sem_trywait(&(queue->q_avail)) != 0) {
+        return errno;
+    }
+
+    pthread_mutex_lock(&(queue->q_mutex));
+    new_elem = queue->q_head.q_forw;
+    remque(queue->q_head.q_forw);
+    pthread_mutex_unlock(&(queue->q_mutex));
+
+    *data = new_elem->q_data;
+
+    free(new_elem);
+
+    return 0;
+
+} // mqueue_trywait
@@ -245,7 +245,7 @@ LACP_mux_fsm(int event,
     }
 
     /* update interface lacp_status data with any changes */
-    db_update_interface(plpinfo);
+    LACP_effect_status(plpinfo);
 
     REXIT();
 } // LACP_mux_fsm
@@ -605,7 +605,7 @@ detach_mux_from_aggregator(lacp_per_port_variables_t *plpinfo)
 
     status = mlacp_blocking_send_detach_aggregator(plpinfo);
     if(status == R_SUCCESS) {
-        plpinfo->sport_handle = 0;
+        LACP_set_sport_handle(plpinfo, 0);
     }
 
 end:
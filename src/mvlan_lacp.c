@@ -28,7 +28,6 @@
 #include <mlacp_debug.h>
 #include <lacp_cmn.h>
 #include <pm_cmn.h>
-#include <nlib.h>
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
 #include "lacp_ops_if.h"
@@ -44,13 +43,27 @@ typedef enum match_type {
     PRIORITY_MATCH
 } match_type_t;
 
-static struct NList *placp_params_list;
+/*
+ * Aggregator match index.  Every set of sport params is hashed twice:
+ *  - on port type and actor key, for PARTIAL and PRIORITY matches.
+ *    Params whose port type or actor key is not set yet may match any
+ *    port, so they are kept on the extra SPORT_KEY_WILDCARD chain.
+ *  - on port type, actor key and partner key, for EXACT matches.
+ * Each protocol shard only matches against its own LAGs.
+ */
+#define SPORT_HASH_SIZE         64      /* Must be a power of 2 */
+#define SPORT_KEY_WILDCARD      SPORT_HASH_SIZE
+
+static __thread lacp_int_sport_params_t *sport_key_hash[SPORT_HASH_SIZE + 1];
+static __thread lacp_int_sport_params_t *sport_partner_hash[SPORT_HASH_SIZE];
 
 /* OpenSwitch: matches port type, actor key, partner sys prio, partner sys id */
 static int mvlan_match_aggregator(lacp_sport_params_t *psport_param,
                                   struct MLt_vpm_api__lacp_match_params *plag_param,
                                   match_type_t match);
 
+static void mvlan_sport_params_hash(lacp_int_sport_params_t *placp_sport_params);
+
 /*-----------------------------------------------------------------------------
  * mvlan_api_modify_sport_params   --
  *
@@ -316,6 +329,8 @@ mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
 
         } else {
             memset(placp_sport_params, 0, sizeof(lacp_int_sport_params_t));
+            placp_sport_params->key_bucket = -1;
+            placp_sport_params->partner_bucket = -1;
         }
 
         // The very first time it's guaranteed to have (only) the tuple.
@@ -398,9 +413,6 @@ mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
 
     if (first_time == TRUE) {
         placp_sport_params->psport = psport;
-        placp_params_list = n_list_insert((struct NList *)
-                                          placp_params_list,
-                                          (void *)placp_sport_params,0);
         psport->placp_params = placp_sport_params;
 
         RDEBUG(DL_VPM, "created new set of aggr params (%s)\n", psport->name);
@@ -409,6 +421,9 @@ mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
         RDEBUG(DL_VPM, "updated aggr params (%s)\n", psport->name);
     }
 
+    // The tuple may have changed, so (re)index the params.
+    mvlan_sport_params_hash(placp_sport_params);
+
     if (partner_param_changed) {
         // OpenSwitch: Inform LACP that aggregator's data has been changed.
         mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params,
@@ -452,10 +467,10 @@ mvlan_unset_sport_params(struct MLt_vpm_api__lacp_sport_params *in_lacp_params)
     placp_sport_params =  psport->placp_params;
     if (placp_sport_params == NULL) {
             RDEBUG(DL_VPM, "%s: placp_sport_params null!\n", __FUNCTION__);
+    } else {
+        mvlan_sport_params_unhash(placp_sport_params);
     }
 
-    placp_params_list = n_list_remove_data((struct NList *)(placp_params_list),
-                                           (void *)placp_sport_params);
     psport->placp_params = NULL;
 
     free(placp_sport_params);
@@ -468,6 +483,208 @@ end:
 
 } // mvlan_unset_sport_params
 
+/*-----------------------------------------------------------------------------
+ * mvlan_sport_hash   --
+ *
+ * Description  -- Returns the match index bucket for the given tuple.
+ *                 The key bucket is the one for a partner key of 0.
+ *
+ * Return value --
+ *            bucket number, 0 .. SPORT_HASH_SIZE-1
+ *---------------------------------------------------------------------------*/
+static int
+mvlan_sport_hash(int port_type, int actor_key, int partner_key)
+{
+    unsigned int hash;
+
+    hash = ((unsigned int)port_type * 0x9e3779b1u) ^ (unsigned int)actor_key;
+    hash = (hash * 0x9e3779b1u) ^ (unsigned int)partner_key;
+    hash *= 0x9e3779b1u;
+
+    return (hash >> 16) & (SPORT_HASH_SIZE - 1);
+
+} // mvlan_sport_hash
+
+/*-----------------------------------------------------------------------------
+ * mvlan_sport_params_unhash   --
+ *
+ *        placp_sport_params - The params for this aggregator
+ *
+ * Description  -- Removes the sport params from the aggregator match index.
+ *                 Does nothing if they are not indexed.
+ *---------------------------------------------------------------------------*/
+void
+mvlan_sport_params_unhash(lacp_int_sport_params_t *placp_sport_params)
+{
+    lacp_int_sport_params_t **pprev;
+
+    if (placp_sport_params->key_bucket >= 0) {
+        pprev = &sport_key_hash[placp_sport_params->key_bucket];
+        while (*pprev && *pprev != placp_sport_params) {
+            pprev = &(*pprev)->key_next;
+        }
+        if (*pprev) {
+            *pprev = placp_sport_params->key_next;
+        }
+        placp_sport_params->key_next = NULL;
+        placp_sport_params->key_bucket = -1;
+    }
+
+    if (placp_sport_params->partner_bucket >= 0) {
+        pprev = &sport_partner_hash[placp_sport_params->partner_bucket];
+        while (*pprev && *pprev != placp_sport_params) {
+            pprev = &(*pprev)->partner_next;
+        }
+        if (*pprev) {
+            *pprev = placp_sport_params->partner_next;
+        }
+        placp_sport_params->partner_next = NULL;
+        placp_sport_params->partner_bucket = -1;
+    }
+
+} // mvlan_sport_params_unhash
+
+/*-----------------------------------------------------------------------------
+ * mvlan_sport_params_hash   --
+ *
+ *        placp_sport_params - The params for this aggregator
+ *
+ * Description  -- (Re)inserts the sport params into the aggregator match
+ *                 index.  Must be called whenever the port type, actor key
+ *                 or partner key of the params change.
+ *---------------------------------------------------------------------------*/
+static void
+mvlan_sport_params_hash(lacp_int_sport_params_t *placp_sport_params)
+{
+    lacp_sport_params_t *pparams = &placp_sport_params->lacp_params;
+    int bucket;
+
+    mvlan_sport_params_unhash(placp_sport_params);
+
+    // Params without a port type or actor key match any port in
+    // PARTIAL_MATCH and PRIORITY_MATCH, see mvlan_match_aggregator.
+    if (pparams->port_type == PM_LPORT_INVALID ||
+        pparams->actor_key == LACP_LAG_INVALID_ACTOR_KEY) {
+        bucket = SPORT_KEY_WILDCARD;
+    } else {
+        bucket = mvlan_sport_hash(pparams->port_type, pparams->actor_key, 0);
+    }
+
+    placp_sport_params->key_bucket = bucket;
+    placp_sport_params->key_next = sport_key_hash[bucket];
+    sport_key_hash[bucket] = placp_sport_params;
+
+    bucket = mvlan_sport_hash(pparams->port_type, pparams->actor_key,
+                              pparams->partner_key);
+
+    placp_sport_params->partner_bucket = bucket;
+    placp_sport_params->partner_next = sport_partner_hash[bucket];
+    sport_partner_hash[bucket] = placp_sport_params;
+
+} // mvlan_sport_params_hash
+
+/*-----------------------------------------------------------------------------
+ * mvlan_match_sport   --
+ *
+ * Description  -- Debug wrapper around mvlan_match_aggregator for one
+ *                 candidate aggregator.
+ *
+ * Return value --
+ *            TRUE/FALSE
+ *---------------------------------------------------------------------------*/
+static int
+mvlan_match_sport(lacp_int_sport_params_t *placp_sport_params,
+                  struct MLt_vpm_api__lacp_match_params *placp_match_params,
+                  match_type_t match)
+{
+    super_port_t *psport = placp_sport_params->psport;
+
+    RDEBUG(DL_VPM, "matching attributes of sport 0x%llx (%s) with "
+           "incoming params\n", psport->handle, psport->name);
+
+    RDEBUG(DL_VPM, "Existing sport params are :\n");
+    RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
+           placp_sport_params->lacp_params.port_type,
+           placp_sport_params->lacp_params.actor_key,
+           placp_sport_params->lacp_params.partner_key);
+    RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
+           "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
+           "aggr_type %d\n",
+           placp_sport_params->lacp_params.partner_system_priority,
+           placp_sport_params->lacp_params.partner_system_id[0],
+           placp_sport_params->lacp_params.partner_system_id[1],
+           placp_sport_params->lacp_params.partner_system_id[2],
+           placp_sport_params->lacp_params.partner_system_id[3],
+           placp_sport_params->lacp_params.partner_system_id[4],
+           placp_sport_params->lacp_params.partner_system_id[5],
+           placp_sport_params->lacp_params.aggr_type);
+
+    return mvlan_match_aggregator(&(placp_sport_params->lacp_params),
+                                  placp_match_params, match);
+
+} // mvlan_match_sport
+
+/*-----------------------------------------------------------------------------
+ * mvlan_find_aggregator   --
+ *
+ *        placp_match_params - The params to be matched
+ *        match              - The type of match
+ *
+ * Description  -- Looks the params up in the aggregator match index.
+ *                 An EXACT_MATCH only needs the params with the same port
+ *                 type, actor key and partner key.  PARTIAL_MATCH and
+ *                 PRIORITY_MATCH look at the params with the same port type
+ *                 and actor key, then at those that have none set yet.
+ *
+ * Return value --
+ *            The matching sport params, or NULL.
+ *---------------------------------------------------------------------------*/
+static lacp_int_sport_params_t *
+mvlan_find_aggregator(struct MLt_vpm_api__lacp_match_params *placp_match_params,
+                      match_type_t match)
+{
+    lacp_int_sport_params_t *placp_sport_params;
+    int bucket;
+
+    if (EXACT_MATCH == match) {
+        bucket = mvlan_sport_hash(placp_match_params->port_type,
+                                  placp_match_params->actor_key,
+                                  placp_match_params->partner_key);
+
+        for (placp_sport_params = sport_partner_hash[bucket];
+             placp_sport_params != NULL;
+             placp_sport_params = placp_sport_params->partner_next) {
+            if (mvlan_match_sport(placp_sport_params, placp_match_params, match)) {
+                return placp_sport_params;
+            }
+        }
+
+        return NULL;
+    }
+
+    bucket = mvlan_sport_hash(placp_match_params->port_type,
+                              placp_match_params->actor_key, 0);
+
+    for (placp_sport_params = sport_key_hash[bucket];
+         placp_sport_params != NULL;
+         placp_sport_params = placp_sport_params->key_next) {
+        if (mvlan_match_sport(placp_sport_params, placp_match_params, match)) {
+            return placp_sport_params;
+        }
+    }
+
+    for (placp_sport_params = sport_key_hash[SPORT_KEY_WILDCARD];
+         placp_sport_params != NULL;
+         placp_sport_params = placp_sport_params->key_next) {
+        if (mvlan_match_sport(placp_sport_params, placp_match_params, match)) {
+            return placp_sport_params;
+        }
+    }
+
+    return NULL;
+
+} // mvlan_find_aggregator
+
 /*-----------------------------------------------------------------------------
  * mvlan_select_aggregator   --
  *
@@ -494,167 +711,128 @@ mvlan_select_aggregator(struct MLt_vpm_api__lacp_match_params *placp_match_param
     int                     status = R_SUCCESS;
     super_port_t            *psport;
     lacp_int_sport_params_t *ptemp_lacp_sport_params = NULL;
-    struct NList            *plist;
-    struct NList            *plist_start = NULL;
-    int                     found_match = FALSE;
     struct  MLt_vpm_api__lacp_sport_params pmsg;
 
-    plist_start = plist = placp_params_list;
-
-    while (plist != NULL) {
-        ptemp_lacp_sport_params = (lacp_int_sport_params_t *)(N_LIST_ELEMENT(plist));
-
-        psport = ptemp_lacp_sport_params->psport;
-        RDEBUG(DL_VPM, "matching attributes of sport 0x%llx (%s) with "
-               "incoming params\n", psport->handle, psport->name);
-
-        RDEBUG(DL_VPM, "Existing sport params are :\n");
-        RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
-               ptemp_lacp_sport_params->lacp_params.port_type,
-               ptemp_lacp_sport_params->lacp_params.actor_key,
-               ptemp_lacp_sport_params->lacp_params.partner_key);
-        RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
-               "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
-               "aggr_type %d\n",
-               ptemp_lacp_sport_params->lacp_params.partner_system_priority,
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[0],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[1],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[2],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[3],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[4],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[5],
-               ptemp_lacp_sport_params->lacp_params.aggr_type);
-
-        RDEBUG(DL_VPM, "Incoming params are :\n");
-        RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
-               placp_match_params->port_type,
-               placp_match_params->actor_key,
-               placp_match_params->partner_key);
-        RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
-               "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
-               "local_port_number %d, flags=0x%x\n\n",
-               placp_match_params->partner_system_priority,
-               placp_match_params->partner_system_id[0],
-               placp_match_params->partner_system_id[1],
-               placp_match_params->partner_system_id[2],
-               placp_match_params->partner_system_id[3],
-               placp_match_params->partner_system_id[4],
-               placp_match_params->partner_system_id[5],
-               placp_match_params->local_port_number,
-               placp_match_params->flags);
-
-        if (mvlan_match_aggregator(&(ptemp_lacp_sport_params->lacp_params),
-                                   placp_match_params, match)) {
-            found_match = TRUE;
-            RDEBUG(DL_VPM, "matched!  psport->handle=0x%llx, match_type=%d.\n",
-                   psport->handle, match);
-
-            // If we found something that wasn't exact_match, go ahead and update
-            // the partner information so the next call to select can find it.
-            //
-            // This is needed because there may be a small time delay between the
-            // time select is made and attach to LAG is called due to protocol
-            // timers.
-            //
-            // By updating the information here as soon as a selection is made,
-            // we allow back-to-back selections of the same parameters to end up
-            // with the same LAG before any attach is performed.
-            //
-            // When a priority match happens we still need to update the values in
-            // the super port in order to replace the old information with the new
-            // one coming from a higher priority port
-            if (PARTIAL_MATCH == match || PRIORITY_MATCH == match) {
-                memcpy(ptemp_lacp_sport_params->lacp_params.partner_system_id,
-                       placp_match_params->partner_system_id,
-                       sizeof(ptemp_lacp_sport_params->lacp_params.partner_system_id));
-
-                ptemp_lacp_sport_params->lacp_params.partner_system_priority =
-                    placp_match_params->partner_system_priority;
-                ptemp_lacp_sport_params->lacp_params.partner_key =
-                    placp_match_params->partner_key;
-
-                // Set the port with the max priority, we set this even when the match is
-                // PARTIAL_MATCH because that match should happen when the first lport is
-                // attached to a sport
-                ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
-                                    placp_match_params->actor_oper_port_priority;
-
-                // Check if the partner priority is higher than the current max partner priority
-                // In partial match we always update partner max port priority
-                if (PARTIAL_MATCH == match ||
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
-                    placp_match_params->partner_oper_port_priority) {
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
-                                    placp_match_params->partner_oper_port_priority;
-                }
-                ptemp_lacp_sport_params->lacp_params.flags |=
-                                    (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_SYSID_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_KEY_FIELD_PRESENT
-                                     | LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT
-                                    );
-
-                // Also update port_type and actor_key now that
-                // OpenSwitch's managing these parameters.
-                ptemp_lacp_sport_params->lacp_params.port_type =
-                    placp_match_params->port_type;
-                ptemp_lacp_sport_params->lacp_params.actor_key =
-                    placp_match_params->actor_key;
-
-                RDEBUG(DL_VPM, "Updating DB with new LAG info: LAG.%d, port_type=%d",
-                       (int)PM_HANDLE2LAG(psport->handle), placp_match_params->port_type);
-
-                // OpenSwitch: update database with new LAG information when first selected.
-                db_update_lag_partner_info((int)PM_HANDLE2LAG(psport->handle));
-            }
-            // (EXACT_MATCH == match)
-            else{
-                // In exact_match we need to update the max_actor_port_priority and
-                // max_partner_port_priority of the sport only if the matched port
-                // has port_priority field present and has higher priority
-                if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT) &&
-                    ptemp_lacp_sport_params->lacp_params.actor_max_port_priority >
-                    placp_match_params->actor_oper_port_priority){
-
-                    ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
-                                                         placp_match_params->actor_oper_port_priority;
-                }
-                if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT) &&
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
-                    placp_match_params->partner_oper_port_priority){
-
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
-                                                         placp_match_params->partner_oper_port_priority;
-                }
-            }
+    RDEBUG(DL_VPM, "Incoming params are :\n");
+    RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
+           placp_match_params->port_type,
+           placp_match_params->actor_key,
+           placp_match_params->partner_key);
+    RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
+           "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
+           "local_port_number %d, flags=0x%x, match_type=%d\n\n",
+           placp_match_params->partner_system_priority,
+           placp_match_params->partner_system_id[0],
+           placp_match_params->partner_system_id[1],
+           placp_match_params->partner_system_id[2],
+           placp_match_params->partner_system_id[3],
+           placp_match_params->partner_system_id[4],
+           placp_match_params->partner_system_id[5],
+           placp_match_params->local_port_number,
+           placp_match_params->flags,
+           match);
+
+    ptemp_lacp_sport_params = mvlan_find_aggregator(placp_match_params, match);
+
+    if (ptemp_lacp_sport_params == NULL) {
+        RDEBUG(DL_VPM, "mvlan_api_select_aggregator: The specified parameters do not exist\n");
+        status  =  MVLAN_LACP_SPORT_PARAMS_NOT_FOUND;
+        goto end;
+    }
 
-            if (PRIORITY_MATCH == match) {
-                // Only necessary to set the flags and the sport handle
-                pmsg.flags = ptemp_lacp_sport_params->lacp_params.flags;
-                pmsg.sport_handle = psport->handle;
-                mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params, &pmsg);
-            }
+    psport = ptemp_lacp_sport_params->psport;
+    RDEBUG(DL_VPM, "matched!  psport->handle=0x%llx, match_type=%d.\n",
+           psport->handle, match);
 
-            break;
+    // If we found something that wasn't exact_match, go ahead and update
+    // the partner information so the next call to select can find it.
+    //
+    // This is needed because there may be a small time delay between the
+    // time select is made and attach to LAG is called due to protocol
+    // timers.
+    //
+    // By updating the information here as soon as a selection is made,
+    // we allow back-to-back selections of the same parameters to end up
+    // with the same LAG before any attach is performed.
+    //
+    // When a priority match happens we still need to update the values in
+    // the super port in order to replace the old information with the new
+    // one coming from a higher priority port
+    if (PARTIAL_MATCH == match || PRIORITY_MATCH == match) {
+        memcpy(ptemp_lacp_sport_params->lacp_params.partner_system_id,
+               placp_match_params->partner_system_id,
+               sizeof(ptemp_lacp_sport_params->lacp_params.partner_system_id));
+
+        ptemp_lacp_sport_params->lacp_params.partner_system_priority =
+            placp_match_params->partner_system_priority;
+        ptemp_lacp_sport_params->lacp_params.partner_key =
+            placp_match_params->partner_key;
+
+        // Set the port with the max priority, we set this even when the match is
+        // PARTIAL_MATCH because that match should happen when the first lport is
+        // attached to a sport
+        ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
+                            placp_match_params->actor_oper_port_priority;
+
+        // Check if the partner priority is higher than the current max partner priority
+        // In partial match we always update partner max port priority
+        if (PARTIAL_MATCH == match ||
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
+            placp_match_params->partner_oper_port_priority) {
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
+                            placp_match_params->partner_oper_port_priority;
         }
-
-        plist = N_LIST_NEXT(plist);
-
-        if (plist == (void *) plist_start) {
-            break;
+        ptemp_lacp_sport_params->lacp_params.flags |=
+                            (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_SYSID_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_KEY_FIELD_PRESENT
+                             | LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT
+                            );
+
+        // Also update port_type and actor_key now that
+        // OpenSwitch's managing these parameters.
+        ptemp_lacp_sport_params->lacp_params.port_type =
+            placp_match_params->port_type;
+        ptemp_lacp_sport_params->lacp_params.actor_key =
+            placp_match_params->actor_key;
+
+        mvlan_sport_params_hash(ptemp_lacp_sport_params);
+
+        RDEBUG(DL_VPM, "Updating DB with new LAG info: LAG.%d, port_type=%d",
+               (int)PM_HANDLE2LAG(psport->handle), placp_match_params->port_type);
+
+        // OpenSwitch: update database with new LAG information when first selected.
+        db_update_lag_partner_info((int)PM_HANDLE2LAG(psport->handle));
+    }
+    // (EXACT_MATCH == match)
+    else{
+        // In exact_match we need to update the max_actor_port_priority and
+        // max_partner_port_priority of the sport only if the matched port
+        // has port_priority field present and has higher priority
+        if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT) &&
+            ptemp_lacp_sport_params->lacp_params.actor_max_port_priority >
+            placp_match_params->actor_oper_port_priority){
+
+            ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
+                                                 placp_match_params->actor_oper_port_priority;
         }
+        if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT) &&
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
+            placp_match_params->partner_oper_port_priority){
 
-    } // while (plist != NULL)
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
+                                                 placp_match_params->partner_oper_port_priority;
+        }
+    }
 
-    if (found_match == FALSE) {
-        RDEBUG(DL_VPM, "mvlan_api_select_aggregator: The specified parameters do not exist\n");
-        status  =  MVLAN_LACP_SPORT_PARAMS_NOT_FOUND;
-        goto end;
+    if (PRIORITY_MATCH == match) {
+        // Only necessary to set the flags and the sport handle
+        pmsg.flags = ptemp_lacp_sport_params->lacp_params.flags;
+        pmsg.sport_handle = psport->handle;
+        mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params, &pmsg);
     }
 
-    ptemp_lacp_sport_params  = plist->data;
-    psport = ptemp_lacp_sport_params->psport;
     placp_match_params->sport_handle = psport->handle;
 
 end:
@@ -948,7 +1126,7 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
     int                       status = R_SUCCESS;
     super_port_t              *psport;
     lacp_int_sport_params_t   *sport_lacp_params = NULL;
-    lacp_per_port_variables_t *plpinfo;
+    lacp_per_port_variables_t *plpinfo, *next;
 
     RDEBUG(DL_VPM, "%s: Entry\n", __FUNCTION__);
 
@@ -973,19 +1151,15 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
 
     RDEBUG(DL_VPM, "Detaching all lports");
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
-        if (plpinfo->sport_handle == sport_handle) {
-            /*
-             * Make selected UNSELECTED, and cause approp. event in
-             * the mux machine.
-             */
-            plpinfo->lacp_control.selected = UNSELECTED;
-            LACP_mux_fsm(E2, plpinfo->mux_fsm_state, plpinfo);
-            plpinfo->lacp_control.ready_n = FALSE;
-        }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+    // E2 may detach the port, which takes it off the lport list.
+    SPORT_FOR_EACH_LPORT_SAFE(plpinfo, next, psport) {
+        /*
+         * Make selected UNSELECTED, and cause approp. event in
+         * the mux machine.
+         */
+        plpinfo->lacp_control.selected = UNSELECTED;
+        LACP_mux_fsm(E2, plpinfo->mux_fsm_state, plpinfo);
+        plpinfo->lacp_control.ready_n = FALSE;
     }
     // All logical ports have been detached from this aggregator (sport).
     // Clean up partner information so that we can reuse this sport
@@ -1008,6 +1182,9 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
                                               LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT    |
                                               LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT);
 
+    // The partner key is part of the EXACT_MATCH index.
+    mvlan_sport_params_hash(sport_lacp_params);
+
     // OpenSwitch: do not clear actor key & port type. For OpenSwitch,
     // LAGs & actor keys are specified and bound together until deleted.
     //  sport_lacp_params->lacp_params.port_type = PM_LPORT_INVALID;
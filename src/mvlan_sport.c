@@ -29,6 +29,8 @@
 #include <avl.h>
 #include <lacp_cmn.h>
 #include <mlacp_debug.h>
+#include <pm_cmn.h>
+#include "lacp.h"
 #include "mvlan_sport.h"
 
 VLOG_DEFINE_THIS_MODULE(mvlan_sport);
@@ -36,10 +38,10 @@ VLOG_DEFINE_THIS_MODULE(mvlan_sport);
 /*****************************************************************************
  * Static  varibles for this file
  *****************************************************************************/
-// Stores the super ports indexed by the super port handle
-lacp_avl_tree_t sport_handle_tree = {0};
+// Stores the shard's super ports indexed by the super port handle
+__thread lacp_avl_tree_t sport_handle_tree = {0};
 
-static bool sport_init_done = FALSE;
+static __thread bool sport_init_done = FALSE;
 
 static int mvlan_validate_sport(struct MLt_vpm_api__create_sport *pcreate,
                                 super_port_t **ppsport);
@@ -245,6 +247,18 @@ mvlan_destroy_sport(super_port_t *psport)
 {
     int status = R_SUCCESS;
     lacp_avl_node_t *psport_node = NULL;
+    lacp_per_port_variables_t *plpinfo, *next;
+
+    /* Ports still naming this sport keep their sport_handle, but
+     * can no longer be reached through it. */
+    SPORT_FOR_EACH_LPORT_SAFE(plpinfo, next, psport) {
+        plpinfo->sport_member.next = NULL;
+        plpinfo->sport_member.prev = NULL;
+        plpinfo->sport_member.psport = NULL;
+        plpinfo->sport_member.prio_next = NULL;
+        plpinfo->sport_member.prio_prev = NULL;
+        plpinfo->sport_member.on_prio_list = FALSE;
+    }
 
     /* The memory for the  super_port_t and the lacp_avl_node_t
      * was contiguously allocated in  mvlan_sport_create(). Therefore
@@ -253,6 +267,10 @@ mvlan_destroy_sport(super_port_t *psport)
 
     LACP_AVL_DELETE(sport_handle_tree, *psport_node);
 
+    if (psport->placp_params != NULL) {
+        mvlan_sport_params_unhash(psport->placp_params);
+    }
+
     free(psport->placp_params);
     free(psport);
 
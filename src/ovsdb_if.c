@@ -41,6 +41,7 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <netinet/ether.h>
+#include <net/if.h>
 
 #include <lacp_cmn.h>
 #include <mlacp_debug.h>
@@ -63,6 +64,10 @@
 #include <poll-loop.h>
 #include <hash.h>
 #include <shash.h>
+#include <svec.h>
+#include <seq.h>
+#include <timeval.h>
+#include <util.h>
 
 VLOG_DEFINE_THIS_MODULE(lacpd_ovsdb_if);
 
@@ -76,22 +81,263 @@ VLOG_DEFINE_THIS_MODULE(lacpd_ovsdb_if);
  * Pool definitions
  *
  *********************************/
-#define BITS_PER_BYTE           8
-#define MAX_ENTRIES_IN_POOL     256
+#define POOL_WORD_BITS          64
+#define MAX_ENTRIES_IN_POOL     (POOL_WORD_BITS * POOL_WORD_BITS)
 /* Wait up to 3 seconds when calling poll_block. */
 #define LACP_POLL_INTERVAL      3000
 
-#define IS_AVAILABLE(a, idx)  ((a[idx/BITS_PER_BYTE] & (1 << (idx % BITS_PER_BYTE))) == 0)
+/* Two level bitmap of free indexes.  Bit w of 'summary' is set while
+ * free[w] has any bit set, so allocation takes two ffs operations. */
+struct index_pool {
+    uint64_t summary;
+    uint64_t free[POOL_WORD_BITS];
+};
+
+static void init_index_pool(struct index_pool *pool, int size);
+static int allocate_next(struct index_pool *pool);
+static void free_index(struct index_pool *pool, int idx);
+
+/* Interface indexes end up in the port field of lport handles. */
+#if MAX_ENTRIES_IN_POOL > PM_MAX_PORTS
+#error "Interface index pool is larger than the lport handle port field"
+#endif
+
+static struct index_pool port_index;
+
+/* Interface index to interface data, for find_iface_data_by_index(). */
+static struct iface_data *iface_index_table[MAX_ENTRIES_IN_POOL];
+
+/* Sequence number of the last interface move between shards. */
+static unsigned int iface_move_seq = 0;
+
+/*********************************
+ *
+ * LACP status writer
+ *
+ * The protocol thread records each interface's LACP status in
+ * iface_status[] and marks it dirty; it never waits on OVSDB for
+ * that.  The OVS thread writes the dirty interfaces (and their
+ * ports) in one non-blocking transaction at most once per
+ * status_interval ms.
+ *
+ *********************************/
+#define LACP_STATUS_INTERVAL_DEFAULT    50
+
+/* LACP status of an interface as last reported by the protocol thread. */
+struct iface_status {
+    bool                    valid;      /* false forces the next update */
+    struct lacp_status_raw  actor;
+    struct lacp_status_raw  partner;
+    bool                    lacp_current;
+    int                     lag_port_type;  /* -1 if not in a LAG */
+};
+
+/* Protects iface_status[], status_dirty[] and status_n_dirty. */
+static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct iface_status iface_status[MAX_ENTRIES_IN_POOL];
+static uint64_t status_dirty[POOL_WORD_BITS];   /* Bitmap of indexes */
+static int status_n_dirty = 0;
+static struct seq *status_seq;      /* Changed when the set turns dirty */
+
+/* Used only by the OVS thread, under OVSDB_LOCK. */
+static int status_interval = LACP_STATUS_INTERVAL_DEFAULT;
+static uint64_t status_seqno;
+static long long status_next_flush = 0;
+static struct ovsdb_idl_txn *status_txn = NULL;
+static long long status_txn_start;
+static int status_txn_n;            /* Entries of status_batch[] written */
+static int status_batch[MAX_ENTRIES_IN_POOL];
+static struct iface_status status_batch_data[MAX_ENTRIES_IN_POOL];
+
+/* Status writer metrics. */
+static unsigned long long status_n_commits = 0;
+static unsigned long long status_n_failed = 0;
+static unsigned long long status_n_updates = 0;
+static int status_last_batch = 0;
+static int status_max_batch = 0;
+static long long status_last_latency = 0;
+static long long status_max_latency = 0;
+static long long status_total_latency = 0;
+
+/*********************************
+ *
+ * LACP state delta channel
+ *
+ * The protocol thread doesn't touch the IDL.  Hardware attach/detach,
+ * LAG membership and LAG partner changes are queued as typed deltas,
+ * and the OVS thread applies everything queued so far in one
+ * transaction.  The queue is double buffered, so once it has grown to
+ * its working size neither side allocates.
+ *
+ *********************************/
+enum lacp_delta_type {
+    LACP_DELTA_HW_ATTACH,           /* Enable RX in h/w */
+    LACP_DELTA_HW_DETACH,           /* Disable RX and TX in h/w */
+    LACP_DELTA_HW_EGRESS_ENABLE,    /* Enable TX in h/w */
+    LACP_DELTA_LAG_PORT_ADD,        /* Interface joined the LAG */
+    LACP_DELTA_LAG_PORT_DELETE,     /* Interface left the LAG */
+    LACP_DELTA_PARTNER_UPDATE,      /* LAG partner info changed */
+    LACP_DELTA_PARTNER_CLEAR,       /* LAG has no partner any more */
+    LACP_DELTA_LINK_RESYNC,         /* Resend link state from OVSDB */
+    LACP_DELTA_SHARD_SYNCED,        /* Shard answered ml_sync_shard() */
+};
+
+struct lacp_delta {
+    enum lacp_delta_type    type;
+    uint16_t                lag_id;
+    int                     port;           /* Interface index */
+    state_parameters_t      actor_state;    /* LAG_PORT_ADD only */
+    int                     lag_port_type;  /* -1 if not in a LAG */
+    unsigned int            seq;            /* SHARD_SYNCED only */
+};
+
+/* Protects the pending queue. */
+static pthread_mutex_t delta_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct lacp_delta *delta_pending = NULL;
+static size_t delta_n_pending = 0;
+static size_t delta_pending_allocated = 0;
+static struct seq *delta_seq;       /* Changed when the queue turns non-empty */
+
+/* Set while the calling protocol thread holds delta_mutex, see
+ * lacpd_delta_hold(). */
+static __thread bool delta_held = false;
+
+/* Used only by the OVS thread, under OVSDB_LOCK. */
+static uint64_t delta_seqno;
+static struct lacp_delta *delta_batch = NULL;
+static size_t delta_batch_allocated = 0;
+
+/* Delta channel metrics. */
+static unsigned long long delta_n_applied = 0;
+static unsigned long long delta_n_batches = 0;
+static unsigned long long delta_n_failed = 0;
+static size_t delta_max_batch = 0;
+static long long delta_last_apply = 0;
+static long long delta_max_apply = 0;
+
+/*********************************
+ *
+ * Failed write recovery
+ *
+ * The interface and port caches record what lacpd wrote before the
+ * transaction commits, so that only changes are sent.  When a commit
+ * fails, the rows it touched are marked for rewrite: their caches are
+ * dropped and db_rewrite_run() writes what lacpd owns in them again.
+ * Used only by the OVS thread, under OVSDB_LOCK.
+ *
+ *********************************/
+#define DB_REWRITE_INTERVAL     1000    /* ms between rewrite attempts */
+
+static bool db_rewrite_pending = false;
+static long long db_rewrite_next = 0;
 
-#define CLEAR(a, idx)   a[idx/BITS_PER_BYTE] &= ~(1 << (idx % BITS_PER_BYTE))
-#define SET(a, idx)     a[idx/BITS_PER_BYTE] |= (1 << (idx % BITS_PER_BYTE))
+/*********************************
+ *
+ * Fast TX disable
+ *
+ * When a member's link goes down, the OVS thread turns off its
+ * hw_bond_config tx_enabled in a transaction of its own before it
+ * processes anything else, so switchd stops hashing traffic onto the
+ * dead link without waiting for the state machines to detach it.  The
+ * state machines still detach the member as usual afterwards.
+ *
+ *********************************/
+struct fast_tx_request {
+    char                    name[IFNAMSIZ];
+    int                     port;           /* Interface index */
+    long long               detected;       /* time_usec() of link down */
+};
+
+/* Protects the pending requests from the kernel link watch. */
+static pthread_mutex_t fast_tx_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct fast_tx_request *fast_tx_pending = NULL;
+static size_t fast_tx_n_pending = 0;
+static size_t fast_tx_pending_allocated = 0;
+static struct seq *fast_tx_seq;     /* Changed when a request is queued */
+
+/* Used only by the OVS thread, under OVSDB_LOCK. */
+static uint64_t fast_tx_seqno;
+static struct fast_tx_request *fast_tx_batch = NULL;
+static size_t fast_tx_batch_allocated = 0;
+
+/* Fast TX disable metrics, latencies are link down to commit. */
+static unsigned long long fast_tx_n_commits = 0;
+static unsigned long long fast_tx_n_ports = 0;
+static long long fast_tx_last_latency = 0;
+static long long fast_tx_max_latency = 0;
+
+/*********************************
+ *
+ * Appctl view
+ *
+ * The appctl server runs on its own thread and can't read the interface
+ * and port caches while the OVS thread is changing them.  After each
+ * pass that changed the caches the OVS thread publishes a read-only copy
+ * of what the dumps show.  A dump holds a reference to the copy that was
+ * current when it started, so neither thread waits for the other to
+ * finish its work.
+ *
+ *********************************/
+struct view_iface {
+    char                    *name;
+    int                     index;
+    int                     link_state;
+    int                     link_speed;
+    int                     duplex;
+    char                    *lag_name;      /* Configured LAG, or NULL */
+    bool                    lag_eligible;
+};
 
-#define POOL(name, size)     unsigned char name[size/BITS_PER_BYTE+1]
+struct view_port {
+    char                    *name;
+    uint16_t                lag_id;
+    enum ovsrec_port_lacp_e lacp_mode;
+    unsigned int            lag_member_speed;
+    int                     n_participants;
+    struct svec             cfg_members;
+    struct svec             eligible_members;
+    struct svec             participant_members;
+};
+
+struct lacpd_view {
+    int                     ref_cnt;        /* Protected by view_mutex */
+    struct shash            interfaces;     /* struct view_iface */
+    struct shash            ports;          /* struct view_port */
+    char                    **lag_names;    /* Port name by LAG ID, or NULL */
+};
 
-int allocate_next(unsigned char *pool, int size);
-static void free_index(unsigned char *pool, int idx);
+/* Status writer, delta channel and fast TX disable metrics as of the last
+ * OVS thread pass. */
+struct view_stats {
+    int                     status_interval;
+    unsigned long long      status_n_commits;
+    unsigned long long      status_n_failed;
+    unsigned long long      status_n_updates;
+    int                     status_last_batch;
+    int                     status_max_batch;
+    long long               status_last_latency;
+    long long               status_max_latency;
+    long long               status_total_latency;
+    unsigned long long      delta_n_applied;
+    unsigned long long      delta_n_batches;
+    unsigned long long      delta_n_failed;
+    size_t                  delta_max_batch;
+    long long               delta_last_apply;
+    long long               delta_max_apply;
+    unsigned long long      fast_tx_n_commits;
+    unsigned long long      fast_tx_n_ports;
+    long long               fast_tx_last_latency;
+    long long               fast_tx_max_latency;
+};
+
+/* Protects the view pointer, view reference counts and view_stats. */
+static pthread_mutex_t view_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct lacpd_view *view = NULL;
+static struct view_stats view_stats;
 
-POOL(port_index, MAX_ENTRIES_IN_POOL);
+/* Used only by the OVS thread.  Set when something the view shows
+ * changed: the configuration, LAG participants or member speed. */
+static bool view_dirty = true;
 
 /*********************************************************/
 
@@ -155,6 +401,9 @@ struct port_data {
     unsigned int        lag_member_speed;   /*!< link speed of LAG members */
     const struct ovsrec_port *cfg;          /*!< Port's idl entry */
     char                *speed_str;         /*!< Most recent speed value */
+    const char          *bond_status_key;   /*!< bond_status key last written, or NULL */
+    char                *bond_speed_str;    /*!< bond_speed last written, or NULL */
+    bool                rewrite;            /*!< A write failed, write again what lacpd owns */
 
     int                 current_status;     /*!< Currently recorded status of LAG */
     int                 timeout_mode;       /*!< 0=long, 1=short */
@@ -172,12 +421,25 @@ struct port_data {
 
 /* NOTE: These LAG IDs are only used for LACP state machine.
  *       They are not necessarily the same as h/w LAG ID. */
-#define LAG_ID_IN_USE   1
+#define LAG_ID_POOL_SIZE    1024
 #define VALID_LAG_ID(x) ((x)>=min_lag_id && (x)<=max_lag_id)
 
+/* LAG IDs come from the same bitmap allocator as interface indexes,
+ * and end up in the id field of super port handles. */
+#if LAG_ID_POOL_SIZE > MAX_ENTRIES_IN_POOL || LAG_ID_POOL_SIZE > SPORT_ID_MASK
+#error "LAG ID pool is too large"
+#endif
+
 const uint16_t min_lag_id = 1;
 uint16_t max_lag_id = 0; // This will be set in init_lag_id_pool
-uint16_t *lag_id_pool = NULL;
+
+/* Free LAG IDs; pool index i is LAG ID min_lag_id + i. */
+static struct index_pool lag_id_pool;
+
+/* Direct LAG ID -> port_data table, indexed by LAG ID.  Entries are
+ * set in alloc_lag_id() and cleared in free_lag_id(), so that the
+ * per mux transition DB updates don't have to scan all_ports. */
+static struct port_data **lag_id_port_table = NULL;
 
 /* To serialize updates to OVSDB.  Both LACP and OVS
  * interface threads calls to update OVSDB states. */
@@ -208,8 +470,25 @@ static void update_interface_bond_status_map_entry(struct iface_data *idp);
 static void update_port_bond_status_map_entry(struct port_data *portp);
 
 static char *lacp_mode_str(enum ovsrec_port_lacp_e mode);
+static void view_run(void);
+static void view_exit(void);
 static void db_clear_interface(struct iface_data *idp);
-static void db_update_port_status(struct port_data *portp);
+static bool db_set_port_status(struct port_data *portp);
+static void set_lag_member_speed(struct port_data *portp, unsigned int speed);
+static void status_txn_complete(void);
+static void status_forget_interface(int port);
+static void status_invalidate(int port);
+static void status_retry(int port);
+static void forget_interface_lacp_status(struct iface_data *idp);
+static void forget_port_status(struct port_data *portp);
+static void db_rewrite_interface(struct iface_data *idp);
+static void db_rewrite_port(struct port_data *portp);
+static void db_rewrite_run(void);
+static void delta_post(const struct lacp_delta *delta);
+static void delta_channel_run(void);
+static void delta_channel_wait(void);
+static void fast_tx_disable_run(void);
+static void fast_tx_disable_wait(void);
 void db_clear_lag_partner_info_port(struct port_data *portp);
 
 /**********************************************************************/
@@ -218,30 +497,27 @@ void db_clear_lag_partner_info_port(struct port_data *portp);
 static void
 init_lag_id_pool(uint16_t count)
 {
-    if (lag_id_pool == NULL) {
+    if (lag_id_port_table == NULL) {
         /* Track how many we're allocating. */
         max_lag_id = count;
+        init_index_pool(&lag_id_pool, count);
 
         /* Allocate an extra one to skip LAG ID 0. */
-        lag_id_pool = (uint16_t *)xcalloc(count+1, sizeof(uint16_t));
+        lag_id_port_table = xcalloc(count+1, sizeof(struct port_data *));
         VLOG_DBG("lacpd: allocated %d LAG IDs", count);
     }
 } /* init_lag_id_pool */
 
 static uint16_t
-alloc_lag_id(void)
+alloc_lag_id(struct port_data *portp)
 {
-    if (lag_id_pool != NULL) {
-        uint16_t id;
+    if (lag_id_port_table != NULL) {
+        int idx = allocate_next(&lag_id_pool);
 
-        for (id=min_lag_id; id<=max_lag_id; id++) {
-
-            if (lag_id_pool[id] == LAG_ID_IN_USE) {
-                continue;
-            }
+        if (idx >= 0) {
+            uint16_t id = min_lag_id + idx;
 
-            /* Found an available LAG_ID. */
-            lag_id_pool[id] = LAG_ID_IN_USE;
+            lag_id_port_table[id] = portp;
             return id;
         }
     } else {
@@ -256,14 +532,15 @@ alloc_lag_id(void)
 static void
 free_lag_id(uint16_t id)
 {
-    if ((lag_id_pool != NULL) && VALID_LAG_ID(id)) {
-        if (lag_id_pool[id] == LAG_ID_IN_USE) {
-            lag_id_pool[id] = 0;
+    if ((lag_id_port_table != NULL) && VALID_LAG_ID(id)) {
+        if (lag_id_port_table[id] != NULL) {
+            free_index(&lag_id_pool, id - min_lag_id);
+            lag_id_port_table[id] = NULL;
         } else {
             VLOG_ERR("Trying to free an unused LAGID (%d)!", id);
         }
     } else {
-        if (lag_id_pool == NULL) {
+        if (lag_id_port_table == NULL) {
             VLOG_ERR("Attempt to free LAG ID when"
                      "pool is not initialized!");
         } else {
@@ -276,15 +553,8 @@ free_lag_id(uint16_t id)
 struct port_data *
 find_port_data_by_lag_id(int lag_id)
 {
-    struct port_data *pdp;
-    struct shash_node *sh_node;
-    SHASH_FOR_EACH(sh_node, &all_ports) {
-        pdp = sh_node->data;
-        if (pdp) {
-            if (pdp->lag_id == lag_id) {
-                return pdp;
-            }
-        }
+    if ((lag_id_port_table != NULL) && VALID_LAG_ID(lag_id)) {
+        return lag_id_port_table[lag_id];
     }
 
     return NULL;
@@ -308,19 +578,11 @@ valid_lacp_timeout(const char *cp)
 struct iface_data *
 find_iface_data_by_index(int index)
 {
-    struct iface_data *idp;
-    struct shash_node *sh_node;
-
-    SHASH_FOR_EACH(sh_node, &all_interfaces) {
-        idp = sh_node->data;
-        if (idp) {
-            if (idp->index == index) {
-                return idp;
-            }
-        }
+    if (index < 0 || index >= MAX_ENTRIES_IN_POOL) {
+        return NULL;
     }
 
-    return NULL;
+    return iface_index_table[index];
 } /* find_iface_data_by_index */
 
 
@@ -341,6 +603,156 @@ alloc_msg(int size)
     return msg;
 } /* alloc_msg */
 
+/**
+ * @details
+ * Tells the protocol shard that ran LACP on an interface so far to stop,
+ * before the interface is configured on another shard.
+ */
+static void
+send_lport_move_msg(struct iface_data *idp, int old_shard)
+{
+    ML_event *event;
+    struct MLt_vpm_api__lport_lacp_change *msg;
+    int msgSize;
+
+    VLOG_DBG("%s: port=%s, old_shard=%d", __FUNCTION__, idp->name, old_shard);
+
+    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__lport_lacp_change);
+
+    event = (ML_event *)alloc_msg(msgSize);
+
+    if (event != NULL) {
+        /*** From LPORT peer. ***/
+        event->sender.peer = ml_lport_index;
+        event->msgnum = MLm_vpm_api__set_lacp_lport_params_event;
+
+        msg = (struct MLt_vpm_api__lport_lacp_change *)(event+1);
+        msg->lport_handle = PM_SMPT2HANDLE(0, 0, idp->index,
+                                           idp->cycl_port_type);
+        msg->lacp_state = LACP_STATE_DISABLED;
+
+        ml_send_event(old_shard, event);
+    }
+} /* send_lport_move_msg */
+
+/**
+ * @details
+ * Holds a message for the interface until its old shard is done with it,
+ * see iface_send_event().
+ */
+static void
+iface_hold_event(struct iface_data *idp, ML_event *event)
+{
+    if (idp->n_held_events == idp->held_events_allocated) {
+        idp->held_events_allocated = (idp->held_events_allocated
+                                      ? 2 * idp->held_events_allocated : 8);
+        idp->held_events = xrealloc(idp->held_events,
+                                    idp->held_events_allocated
+                                    * sizeof *idp->held_events);
+    }
+    idp->held_events[idp->n_held_events++] = event;
+} /* iface_hold_event */
+
+/**
+ * @details
+ * The old shard of a moving interface is done with it: it now runs on
+ * the new shard, which gets the messages held for it in order.
+ */
+static void
+iface_move_done(struct iface_data *idp)
+{
+    size_t i;
+
+    idp->move_pending = false;
+    __atomic_store_n(&idp->proto_shard, idp->move_shard, __ATOMIC_RELEASE);
+
+    for (i = 0; i < idp->n_held_events; i++) {
+        if (ml_send_event(idp->move_shard, idp->held_events[i])) {
+            free(idp->held_events[i]);
+        }
+    }
+    idp->n_held_events = 0;
+
+    /* LACP no longer runs on the interface on any shard. */
+    if (idp->lacp_state != LACP_STATE_ENABLED) {
+        __atomic_store_n(&idp->proto_shard, -1, __ATOMIC_RELEASE);
+    }
+} /* iface_move_done */
+
+/**
+ * @details
+ * Drops the messages held for an interface that is going away.
+ */
+static void
+iface_drop_held_events(struct iface_data *idp)
+{
+    size_t i;
+
+    for (i = 0; i < idp->n_held_events; i++) {
+        free(idp->held_events[i]);
+    }
+    free(idp->held_events);
+    idp->held_events = NULL;
+    idp->n_held_events = 0;
+    idp->held_events_allocated = 0;
+} /* iface_drop_held_events */
+
+/**
+ * @details
+ * Sends a message about the interface to its protocol shard.  An
+ * interface is run by the shard of the LAG it is configured in; messages
+ * for interfaces without a LAG go to the shard that ran the interface
+ * last, or to shard 0.
+ *
+ * When the interface moves to a LAG of another shard while LACP is still
+ * running on it, the old shard is told to disable LACP on it and to
+ * answer through the delta channel once its detach is out, see
+ * lacpd_shard_synced().  Until then the messages for the interface are
+ * held, so the port is never active on two shards and the new shard only
+ * attaches it after the old one has detached it.  The OVS thread never
+ * waits for a shard.
+ *
+ * proto_shard is read by the LACPDU RX thread, so it is only written
+ * with atomic stores.
+ */
+static void
+iface_send_event(struct iface_data *idp, ML_event *event)
+{
+    struct port_data *portp = idp->port_datap;
+    int shard;
+
+    if (portp == NULL || portp->lag_id == 0) {
+        shard = (idp->proto_shard < 0) ? 0 : idp->proto_shard;
+    } else {
+        shard = ml_lag_shard(portp->lag_id);
+
+        if (!idp->move_pending &&
+            idp->proto_shard >= 0 && idp->proto_shard != shard) {
+            send_lport_move_msg(idp, idp->proto_shard);
+            idp->move_seq = ++iface_move_seq;
+            if (ml_sync_shard(idp->proto_shard, idp->index,
+                              idp->move_seq) == 0) {
+                idp->move_pending = true;
+            } else {
+                VLOG_WARN("Interface %s moves to shard %d without waiting "
+                          "for shard %d", idp->name, shard, idp->proto_shard);
+            }
+        }
+
+        if (idp->move_pending) {
+            idp->move_shard = shard;
+        } else {
+            __atomic_store_n(&idp->proto_shard, shard, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (idp->move_pending) {
+        iface_hold_event(idp, event);
+    } else if (ml_send_event(shard, event)) {
+        free(event);
+    }
+} /* iface_send_event */
+
 static void
 set_port_overrides(struct port_data *portp, struct iface_data *idp)
 {
@@ -381,7 +793,7 @@ set_port_overrides(struct port_data *portp, struct iface_data *idp)
             }
         }
 
-        ml_send_event(event);
+        iface_send_event(idp, event);
     }
 }
 
@@ -413,7 +825,7 @@ clear_port_overrides(struct iface_data *idp)
         msg->priority = 0;
         memset(msg->actor_sys_mac, 0, sizeof(msg->actor_sys_mac));
 
-        ml_send_event(event);
+        iface_send_event(idp, event);
     }
 }
 
@@ -444,7 +856,7 @@ send_sys_pri_msg(int priority)
         msg = (struct MLt_lacp_api__actorSysPriority *)(event+1);
         msg->actor_system_priority = priority;
 
-        ml_send_event(event);
+        ml_broadcast_event(event, msgSize);
     }
 } /* send_sys_pri_msg */
 
@@ -477,7 +889,7 @@ send_sys_mac_msg(struct ether_addr *macAddr)
         /* Copy MAC address. */
         memcpy(macMsg->actor_sys_mac, macAddr, ETH_ALEN);
 
-        ml_send_event(event);
+        ml_broadcast_event(event, msgSize);
     }
 } /* send_sys_mac_msg */
 
@@ -509,7 +921,7 @@ send_lag_create_msg(int lag_id)
         msg->handle = PM_LAG2HANDLE(lag_id);
         msg->type = STYPE_802_3AD;
 
-        ml_send_event(event);
+        ml_send_event(ml_lag_shard(lag_id), event);
     }
 } /* send_lag_create_msg */
 
@@ -540,7 +952,7 @@ send_lag_delete_msg(int lag_id)
         msg = (struct MLt_vpm_api__delete_sport *)(event+1);
         msg->handle = PM_LAG2HANDLE(lag_id);
 
-        ml_send_event(event);
+        ml_send_event(ml_lag_shard(lag_id), event);
     }
 } /* send_lag_delete_msg */
 
@@ -577,7 +989,7 @@ send_config_lag_msg(int lag_id, int actor_key, int cycl_ptype)
         msg->port_type = cycl_ptype;
         msg->actor_key = actor_key;
 
-        ml_send_event(event);
+        ml_send_event(ml_lag_shard(lag_id), event);
     }
 } /* send_config_lag_msg */
 
@@ -608,7 +1020,7 @@ send_unconfig_lag_msg(int lag_id)
         msg = (struct MLt_vpm_api__lacp_sport_params *)(event+1);
         msg->sport_handle = PM_LAG2HANDLE(lag_id);
 
-        ml_send_event(event);
+        ml_send_event(ml_lag_shard(lag_id), event);
     }
 } /* send_unconfig_lag_msg */
 
@@ -696,7 +1108,14 @@ send_config_lport_msg(struct iface_data *info_ptr)
             }
         }
 
-        ml_send_event(event);
+        iface_send_event(info_ptr, event);
+
+        /* LACP no longer runs on the interface on any shard.  For a
+         * moving interface iface_move_done() sees to it. */
+        if (info_ptr->lacp_state != LACP_STATE_ENABLED &&
+            !info_ptr->move_pending) {
+            __atomic_store_n(&info_ptr->proto_shard, -1, __ATOMIC_RELEASE);
+        }
     }
 } /* send_config_lport_msg */
 
@@ -741,7 +1160,7 @@ send_lport_lacp_change_msg(struct iface_data *info_ptr, unsigned int flags)
 
         msg->flags = (flags | LACP_LPORT_DYNAMIC_FIELDS_PRESENT);
 
-        ml_send_event(event);
+        iface_send_event(info_ptr, event);
     }
 } /* send_lport_lacp_change_msg */
 
@@ -777,7 +1196,7 @@ send_link_state_change_msg(struct iface_data *info_ptr)
                                            info_ptr->cycl_port_type);
         msg->link_speed = info_ptr->link_speed;
 
-        ml_send_event(event);
+        iface_send_event(info_ptr, event);
     }
 } /* send_link_state_change_msg */
 
@@ -814,7 +1233,7 @@ send_fallback_status_msg(struct iface_data *info_ptr, bool fallback_status)
                                            info_ptr->cycl_port_type);
         msg->status = fallback_status;
 
-        ml_send_event(event);
+        iface_send_event(info_ptr, event);
     }
 } /* send_fallback_status_msg */
 
@@ -857,6 +1276,8 @@ configure_lacp_on_interface(struct port_data *portp, struct iface_data *idp)
  *     System:cur_cfg
  *     Port:name, lacp, and interfaces columns.
  *     Interface:name, link_state, link_speed, hw_bond_config columns.
+ *
+ * Changes to the Port and Interface configuration columns are tracked.
  */
 void
 lacpd_ovsdb_if_init(const char *db_path)
@@ -906,9 +1327,34 @@ lacpd_ovsdb_if_init(const char *db_path)
     ovsdb_idl_add_column(idl, &ovsrec_interface_col_bond_status);
     ovsdb_idl_omit_alert(idl, &ovsrec_interface_col_bond_status);
 
+    /* Track changes to the configuration columns, so reconfiguration
+     * only needs to look at the rows that changed.  Inserted and
+     * deleted rows are tracked for every table with a tracked column. */
+    ovsdb_idl_track_add_column(idl, &ovsrec_port_col_name);
+    ovsdb_idl_track_add_column(idl, &ovsrec_port_col_lacp);
+    ovsdb_idl_track_add_column(idl, &ovsrec_port_col_interfaces);
+    ovsdb_idl_track_add_column(idl, &ovsrec_port_col_other_config);
+    ovsdb_idl_track_add_column(idl, &ovsrec_interface_col_name);
+    ovsdb_idl_track_add_column(idl, &ovsrec_interface_col_duplex);
+    ovsdb_idl_track_add_column(idl, &ovsrec_interface_col_link_state);
+    ovsdb_idl_track_add_column(idl, &ovsrec_interface_col_link_speed);
+    ovsdb_idl_track_add_column(idl, &ovsrec_interface_col_other_config);
+
     /* Initialize LAG ID pool. */
     /* OPS_TODO: read # of LAGs from somewhere? */
-    init_lag_id_pool(128);
+    init_lag_id_pool(LAG_ID_POOL_SIZE);
+
+    /* Initialize interface index pool. */
+    init_index_pool(&port_index, MAX_ENTRIES_IN_POOL);
+
+    status_seq = seq_create();
+    status_seqno = seq_read(status_seq);
+
+    delta_seq = seq_create();
+    delta_seqno = seq_read(delta_seq);
+
+    fast_tx_seq = seq_create();
+    fast_tx_seqno = seq_read(fast_tx_seq);
 
 } /* lacpd_ovsdb_if_init */
 
@@ -918,7 +1364,19 @@ lacpd_ovsdb_if_exit(void)
     shash_destroy_free_data(&all_ports);
     shash_destroy_free_data(&all_interfaces);
     shash_destroy_free_data(&interfaces_recently_added);
+    if (status_txn) {
+        ovsdb_idl_txn_destroy(status_txn);
+        status_txn = NULL;
+    }
     ovsdb_idl_destroy(idl);
+    seq_destroy(status_seq);
+    seq_destroy(delta_seq);
+    seq_destroy(fast_tx_seq);
+    free(delta_pending);
+    free(delta_batch);
+    free(fast_tx_pending);
+    free(fast_tx_batch);
+    view_exit();
 } /* lacpd_ovsdb_if_exit */
 
 
@@ -928,7 +1386,13 @@ del_old_interface(struct shash_node *sh_node)
     if (sh_node) {
         struct iface_data *idp = sh_node->data;
         free(idp->name);
-        free_index(port_index, idp->index);
+        if (idp->index >= 0) {
+            iface_index_table[idp->index] = NULL;
+            status_forget_interface(idp->index);
+            ml_link_watch_remove(idp->index);
+            free_index(&port_index, idp->index);
+        }
+        iface_drop_held_events(idp);
         free(idp);
         shash_delete(&all_interfaces, sh_node);
     }
@@ -964,9 +1428,11 @@ add_new_interface(const struct ovsrec_interface *ifrow)
         /* Allocate interface index. */
         /* -- use hw_intf_info:switch_intf_id for now.
          * -- may be overridden with OVS's other_config:lacp-port-id. */
-        idp->index = allocate_next(port_index, MAX_ENTRIES_IN_POOL);
+        idp->index = allocate_next(&port_index);
         if (idp->index < 0) {
             VLOG_ERR("Invalid interface index=%d", idp->index);
+        } else {
+            iface_index_table[idp->index] = idp;
         }
 
         /* Save the reference to IDL row. */
@@ -975,6 +1441,7 @@ add_new_interface(const struct ovsrec_interface *ifrow)
         idp->lag_eligible = false;
         idp->lacp_current = false;
         idp->lacp_current_set = false;
+        idp->proto_shard = -1;
 
         int key = smap_get_int(&(ifrow->other_config),
                               INTERFACE_OTHER_CONFIG_MAP_LACP_AGGREGATION_KEY,
@@ -1049,51 +1516,67 @@ add_new_interface(const struct ovsrec_interface *ifrow)
  * data from OVSDB.
  * Takes necessary actions to propagate database changes.
  *
+ * Only the interface rows the IDL tracked as inserted, modified or
+ * deleted since the last call are looked at, and of a modified row only
+ * the columns that changed.  A row that is not cached yet is read in
+ * full, even if the IDL no longer reports it as new because it was
+ * modified after the insert, e.g. before the system got configured.
+ *
  * @return positive integer if an ovsdb write is required 0 otherwise.
  */
 static int
 update_interface_cache(void)
 {
-    struct shash sh_idl_interfaces;
     const struct ovsrec_interface *ifrow;
     struct shash_node *sh_node, *sh_next;
+    struct shash added = SHASH_INITIALIZER(&added);
+    bool rows_deleted = false;
     int rc = 0;
 
-    /* Collect all the interfaces in the DB. */
-    shash_init(&sh_idl_interfaces);
-    OVSREC_INTERFACE_FOR_EACH(ifrow, idl) {
-        if (!shash_add_once(&sh_idl_interfaces, ifrow->name, ifrow)) {
-            VLOG_WARN("interface %s specified twice", ifrow->name);
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        if (ovsrec_interface_is_deleted(ifrow)) {
+            rows_deleted = true;
+            break;
         }
     }
 
-    /* Delete old interfaces. */
-    SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_interfaces) {
-        struct iface_data *idp =
-            shash_find_data(&sh_idl_interfaces, sh_node->name);
-        if (!idp) {
-            VLOG_DBG("Found a deleted interface %s", sh_node->name);
-            del_old_interface(sh_node);
+    /* Delete old interfaces.  Only the row pointer of a deleted row is
+     * still usable, so match it against the cached rows. */
+    if (rows_deleted) {
+        SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_interfaces) {
+            struct iface_data *idp = sh_node->data;
+            if (ovsrec_interface_is_deleted(idp->cfg)) {
+                VLOG_DBG("Found a deleted interface %s", sh_node->name);
+                del_old_interface(sh_node);
+            }
         }
     }
 
     /* Add new interfaces. */
-    SHASH_FOR_EACH(sh_node, &sh_idl_interfaces) {
-        struct iface_data *idp =
-            shash_find_data(&all_interfaces, sh_node->name);
-        if (!idp) {
-            VLOG_DBG("Found an added interface %s", sh_node->name);
-            add_new_interface(sh_node->data);
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        if (!ovsrec_interface_is_deleted(ifrow) &&
+            !shash_find_data(&all_interfaces, ifrow->name)) {
+            VLOG_DBG("Found an added interface %s", ifrow->name);
+            add_new_interface(ifrow);
+            shash_add_once(&added, ifrow->name, ifrow);
             rc++;
         }
     }
 
     /* Check for changes in the interface row entries. */
-    SHASH_FOR_EACH(sh_node, &all_interfaces) {
-        struct iface_data *idp = sh_node->data;
-        const struct ovsrec_interface *ifrow =
-            shash_find_data(&sh_idl_interfaces, sh_node->name);
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        struct iface_data *idp;
         unsigned int flag = 0;
+        bool is_new;
+
+        if (ovsrec_interface_is_deleted(ifrow)) {
+            continue;
+        }
+
+        idp = shash_find_data(&all_interfaces, ifrow->name);
+        if (!idp) {
+            continue;
+        }
 
         /* Internal interfaces doesn't participate in LAGs. */
         if (idp->intf_type == INTERFACE_TYPE_INTERNAL) {
@@ -1101,16 +1584,16 @@ update_interface_cache(void)
             continue;
         }
 
-        /* Check for changes to row. */
-        if (OVSREC_IDL_IS_ROW_INSERTED(ifrow, idl_seqno) ||
-            OVSREC_IDL_IS_ROW_MODIFIED(ifrow, idl_seqno)) {
+        is_new = (shash_find_data(&added, ifrow->name) != NULL);
+
+        /* Check for changes to LACP configuration. */
+        if (is_new ||
+            ovsrec_interface_is_updated(ifrow,
+                                        OVSREC_INTERFACE_COL_OTHER_CONFIG)) {
 
             int val;
             int key = 0;
             const char* key_str = NULL;
-            unsigned int new_speed;
-            enum ovsrec_interface_duplex_e new_duplex;
-            enum ovsrec_interface_link_state_e new_link_state;
             int new_port_id;
 
             /* Update actor_priority */
@@ -1125,28 +1608,6 @@ update_interface_cache(void)
                 flag = 1;
             }
 
-            new_link_state = INTERFACE_LINK_STATE_DOWN;
-            if (ifrow->link_state) {
-                if (!strcmp(ifrow->link_state, OVSREC_INTERFACE_LINK_STATE_UP)) {
-                    new_link_state = INTERFACE_LINK_STATE_UP;
-                }
-            }
-
-            /* Although speed & duplex should only change if link state
-               has changed, the IDL change notices may not all come at
-               the same time! */
-            new_speed = 0;
-            if (ifrow->n_link_speed > 0) {
-                /* There should only be one speed. */
-                new_speed = INTF_TO_LACP_LINK_SPEED(ifrow->link_speed[0]);
-            }
-
-            new_duplex = INTERFACE_DUPLEX_HALF;
-            if (ifrow->duplex) {
-                if (!strcmp(ifrow->duplex, OVSREC_INTERFACE_DUPLEX_FULL)) {
-                    new_duplex = INTERFACE_DUPLEX_FULL;
-                }
-            }
             /* Update Port Id*/
             new_port_id = smap_get_int(&(ifrow->other_config),
                                         INTERFACE_OTHER_CONFIG_MAP_LACP_PORT_ID,
@@ -1187,6 +1648,43 @@ update_interface_cache(void)
             if (flag) {
                 send_config_lport_msg(idp);
             }
+        }
+
+        /* Check for changes to link state. */
+        if (is_new ||
+            ovsrec_interface_is_updated(ifrow,
+                                        OVSREC_INTERFACE_COL_LINK_STATE) ||
+            ovsrec_interface_is_updated(ifrow,
+                                        OVSREC_INTERFACE_COL_LINK_SPEED) ||
+            ovsrec_interface_is_updated(ifrow,
+                                        OVSREC_INTERFACE_COL_DUPLEX)) {
+
+            unsigned int new_speed;
+            enum ovsrec_interface_duplex_e new_duplex;
+            enum ovsrec_interface_link_state_e new_link_state;
+
+            new_link_state = INTERFACE_LINK_STATE_DOWN;
+            if (ifrow->link_state) {
+                if (!strcmp(ifrow->link_state, OVSREC_INTERFACE_LINK_STATE_UP)) {
+                    new_link_state = INTERFACE_LINK_STATE_UP;
+                }
+            }
+
+            /* Although speed & duplex should only change if link state
+               has changed, the IDL change notices may not all come at
+               the same time! */
+            new_speed = 0;
+            if (ifrow->n_link_speed > 0) {
+                /* There should only be one speed. */
+                new_speed = INTF_TO_LACP_LINK_SPEED(ifrow->link_speed[0]);
+            }
+
+            new_duplex = INTERFACE_DUPLEX_HALF;
+            if (ifrow->duplex) {
+                if (!strcmp(ifrow->duplex, OVSREC_INTERFACE_DUPLEX_FULL)) {
+                    new_duplex = INTERFACE_DUPLEX_FULL;
+                }
+            }
 
             if ((new_link_state != idp->link_state) ||
                 (new_speed != idp->link_speed) ||
@@ -1234,8 +1732,7 @@ update_interface_cache(void)
         }
     }
 
-    /* Destroy the shash of the IDL interfaces. */
-    shash_destroy(&sh_idl_interfaces);
+    shash_destroy(&added);
 
     return rc;
 } /* update_interface_cache */
@@ -1257,16 +1754,20 @@ update_interface_hw_bond_config_map_entry(struct iface_data *idp,
                                           const char *entry_key,
                                           const char *entry_value)
 {
-    const struct ovsrec_interface *ifrow;
-    struct smap smap;
-
-    ifrow = idp->cfg;
-    smap_clone(&smap, &ifrow->hw_bond_config);
-    smap_replace(&smap, entry_key, entry_value);
-
-    ovsrec_interface_set_hw_bond_config(ifrow, &smap);
-
-    smap_destroy(&smap);
+    bool enabled = !strcmp(entry_value,
+                           INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE);
+
+    /* Only the changed key goes into the transaction.  The IDL doesn't
+     * apply partial updates to its cache until they commit, so keep our
+     * own copy for the readers in the same transaction. */
+    ovsrec_interface_update_hw_bond_config_setkey(idp->cfg, entry_key,
+                                                  entry_value);
+
+    if (!strcmp(entry_key, INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED)) {
+        idp->hw_bond_rx_enabled = enabled;
+    } else if (!strcmp(entry_key, INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED)) {
+        idp->hw_bond_tx_enabled = enabled;
+    }
 
     return 1;
 } /* update_interface_hw_bond_config_map_entry */
@@ -1347,66 +1848,80 @@ update_member_interface_bond_status(struct port_data *portp)
     }
 } /* update_member_interface_bond_status */
 
+static bool
+status_key_equal(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp(a, b));
+} /* status_key_equal */
+
+static const char *const interface_bond_status_keys[] = {
+    INTERFACE_BOND_STATUS_UP,
+    INTERFACE_BOND_STATUS_BLOCKED,
+    INTERFACE_BOND_STATUS_DOWN,
+};
+
+static const char *const port_bond_status_keys[] = {
+    PORT_BOND_STATUS_UP,
+    PORT_BOND_STATUS_BLOCKED,
+    PORT_BOND_STATUS_DOWN,
+};
+
 /**
- * Update bond_status configuration for a given interface
+ * Makes 'key' (or nothing, if NULL) the only status flag in an interface's
+ * bond_status column, using partial map updates.
  *
  * NOTE: ovsdb_mutex must be taken prior to calling this function.
- *
- * @param idp  iface_data pointer to the interface entry.
  */
 static void
-update_interface_bond_status_map_entry(struct iface_data *idp)
+set_interface_bond_status_key(struct iface_data *idp, const char *key)
 {
-    const struct ovsrec_interface *ifrow;
-    struct smap smap;
-    struct smap_node *node;
-    bool rx_enable = false;
-    bool tx_enable = false;
+    const struct ovsrec_interface *ifrow = idp->cfg;
+    size_t i;
 
-    ifrow = idp->cfg;
-    smap_init(&smap);
+    for (i = 0; i < ARRAY_SIZE(interface_bond_status_keys); i++) {
+        const char *old = interface_bond_status_keys[i];
 
-    if (idp->link_state == INTERFACE_LINK_STATE_UP) {
+        if (!status_key_equal(old, key) &&
+            (status_key_equal(old, idp->bond_status_key) ||
+             smap_get(&ifrow->bond_status, old))) {
+            ovsrec_interface_update_bond_status_delkey(ifrow, old);
+        }
+    }
 
-        SMAP_FOR_EACH(node, &ifrow->hw_bond_config) {
+    if (key && (!status_key_equal(key, idp->bond_status_key) ||
+                !smap_get(&ifrow->bond_status, key))) {
+        ovsrec_interface_update_bond_status_setkey(
+            ifrow, key, INTERFACE_BOND_STATUS_ENABLED_TRUE);
+    }
 
-            if (!strncmp(node->key,
-                         INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
-                         strlen(INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED))
-                && !strncmp(node->value,
-                            INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE,
-                            strlen(INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE))) {
-                rx_enable = true;
-            }
-            else if (!strncmp(node->key,
-                     INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
-                     strlen(INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED))
-                     && !strncmp(node->value,
-                                 INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE,
-                                 strlen(INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE))) {
-                tx_enable = true;
-            }
-        }
+    idp->bond_status_key = key;
+} /* set_interface_bond_status_key */
+
+/**
+ * Update bond_status configuration for a given interface
+ *
+ * NOTE: ovsdb_mutex must be taken prior to calling this function.
+ *
+ * @param idp  iface_data pointer to the interface entry.
+ */
+static void
+update_interface_bond_status_map_entry(struct iface_data *idp)
+{
+    const char *key;
 
-        if (tx_enable && rx_enable) {
-            smap_replace(&smap,
-                         INTERFACE_BOND_STATUS_UP,
-                         INTERFACE_BOND_STATUS_ENABLED_TRUE);
+    if (idp->link_state == INTERFACE_LINK_STATE_UP) {
+        if (idp->hw_bond_tx_enabled && idp->hw_bond_rx_enabled) {
+            key = INTERFACE_BOND_STATUS_UP;
         } else {
-            smap_replace(&smap,
-                         INTERFACE_BOND_STATUS_BLOCKED,
-                         INTERFACE_BOND_STATUS_ENABLED_TRUE);
+            key = INTERFACE_BOND_STATUS_BLOCKED;
         }
     }
     /* Interface link is down */
     else {
-        smap_replace(&smap,
-                     INTERFACE_BOND_STATUS_DOWN,
-                     INTERFACE_BOND_STATUS_ENABLED_TRUE);
+        key = INTERFACE_BOND_STATUS_DOWN;
     }
 
-    ovsrec_interface_set_bond_status(ifrow, &smap);
-    smap_destroy(&smap);
+    set_interface_bond_status_key(idp, key);
 } /* update_interface_bond_status_map_entry */
 
 /**
@@ -1420,17 +1935,7 @@ update_interface_bond_status_map_entry(struct iface_data *idp)
 static void
 remove_interface_bond_status_map_entry(struct iface_data *idp)
 {
-    const struct ovsrec_interface *ifrow;
-    struct smap smap;
-
-    ifrow = idp->cfg;
-    smap_init(&smap);
-    smap_remove(&smap, INTERFACE_BOND_STATUS_DOWN);
-    smap_remove(&smap, INTERFACE_BOND_STATUS_BLOCKED);
-    smap_remove(&smap, INTERFACE_BOND_STATUS_UP);
-
-    ovsrec_interface_set_bond_status(ifrow, &smap);
-    smap_destroy(&smap);
+    set_interface_bond_status_key(idp, NULL);
 } /* remove_interface_bond_status_map_entry */
 
 /**
@@ -1454,10 +1959,10 @@ remove_interface_bond_status_map_entry(struct iface_data *idp)
 static void
 update_port_bond_status_map_entry(struct port_data *portp)
 {
-    const struct ovsrec_interface *ifrow;
-    struct smap smap;
+    const struct ovsrec_port *prow;
     struct shash_node *node, *next;
-    struct smap_node *snode;
+    const char *key = NULL;
+    size_t i;
     int total_intf = 0;
     int blocked_intf = 0;
     int up_intf = 0;
@@ -1475,60 +1980,77 @@ update_port_bond_status_map_entry(struct port_data *portp)
         return;
     }
 
-    smap_init(&smap);
+    prow = portp->cfg;
 
     SHASH_FOR_EACH_SAFE(node, next, &portp->cfg_member_ifs) {
 
         struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            ifrow = idp->cfg;
-            SMAP_FOR_EACH(snode, &ifrow->bond_status) {
-
-                if (!strncmp(snode->key,
-                             INTERFACE_BOND_STATUS_UP,
-                             strlen(INTERFACE_BOND_STATUS_UP))) {
-                    up_intf++;
-                } else if (!strncmp(snode->key,
-                           INTERFACE_BOND_STATUS_BLOCKED,
-                           strlen(INTERFACE_BOND_STATUS_BLOCKED))) {
-                    blocked_intf++;
-                } else if (!strncmp(snode->key,
-                           INTERFACE_BOND_STATUS_DOWN,
-                           strlen(INTERFACE_BOND_STATUS_DOWN))) {
-                    down_intf++;
-                }
-
-                total_intf++;
+        if (idp && idp->bond_status_key) {
+            const char *ikey = idp->bond_status_key;
+
+            if (!strcmp(ikey, INTERFACE_BOND_STATUS_UP)) {
+                up_intf++;
+            } else if (!strcmp(ikey, INTERFACE_BOND_STATUS_BLOCKED)) {
+                blocked_intf++;
+            } else if (!strcmp(ikey, INTERFACE_BOND_STATUS_DOWN)) {
+                down_intf++;
             }
+
+            total_intf++;
         }
     }
 
     if (down_intf == total_intf) {
-           smap_replace(&smap,
-                        PORT_BOND_STATUS_DOWN,
-                        PORT_BOND_STATUS_ENABLED_TRUE);
+        key = PORT_BOND_STATUS_DOWN;
     } else if (blocked_intf == total_intf) {
-        smap_replace(&smap,
-                     PORT_BOND_STATUS_BLOCKED,
-                     PORT_BOND_STATUS_ENABLED_TRUE);
+        key = PORT_BOND_STATUS_BLOCKED;
     } else if (up_intf > 0) {
-        smap_replace(&smap,
-                     PORT_BOND_STATUS_UP,
-                     PORT_BOND_STATUS_ENABLED_TRUE);
+        key = PORT_BOND_STATUS_UP;
     }
 
+    /* Send only the keys that changed.  Stale flags left in the row by
+     * an earlier run are removed as well. */
+    for (i = 0; i < ARRAY_SIZE(port_bond_status_keys); i++) {
+        const char *old = port_bond_status_keys[i];
+
+        if (!status_key_equal(old, key) &&
+            (status_key_equal(old, portp->bond_status_key) ||
+             smap_get(&prow->bond_status, old))) {
+            ovsrec_port_update_bond_status_delkey(prow, old);
+        }
+    }
+
+    if (key && (!status_key_equal(key, portp->bond_status_key) ||
+                !smap_get(&prow->bond_status, key))) {
+        ovsrec_port_update_bond_status_setkey(prow, key,
+                                              PORT_BOND_STATUS_ENABLED_TRUE);
+    }
+
+    portp->bond_status_key = key;
+
     /* Update bond_speed */
     /* If the LAG has no member interfaces, then bond_speed is empty. */
     if (total_intf == 0) {
-        smap_remove(&smap, PORT_BOND_STATUS_MAP_BOND_SPEED);
+        if (portp->bond_speed_str ||
+            smap_get(&prow->bond_status, PORT_BOND_STATUS_MAP_BOND_SPEED)) {
+            ovsrec_port_update_bond_status_delkey(
+                prow, PORT_BOND_STATUS_MAP_BOND_SPEED);
+        }
+        free(portp->bond_speed_str);
+        portp->bond_speed_str = NULL;
     } else {
         long speed_in_bps = (long)portp->lag_member_speed * MEGA_BITS_PER_SEC;
         asprintf(&speed_str, "%ld", speed_in_bps);
-        smap_replace(&smap, PORT_BOND_STATUS_MAP_BOND_SPEED, speed_str);
+        if (portp->bond_speed_str == NULL ||
+            strcmp(speed_str, portp->bond_speed_str) != 0) {
+            ovsrec_port_update_bond_status_setkey(
+                prow, PORT_BOND_STATUS_MAP_BOND_SPEED, speed_str);
+            free(portp->bond_speed_str);
+            portp->bond_speed_str = speed_str;
+        } else {
+            free(speed_str);
+        }
     }
-
-    ovsrec_port_set_bond_status(portp->cfg, &smap);
-    smap_destroy(&smap);
 } /* update_port_bond_status_map_entry */
 
 /**
@@ -1836,7 +2358,7 @@ handle_port_config(const struct ovsrec_port *row, struct port_data *portp)
 
             /* Create super port in LACP state machine. */
             if (!portp->lag_id) {
-                portp->lag_id = alloc_lag_id();
+                portp->lag_id = alloc_lag_id(portp);
             }
 
             if (portp->lag_id) {
@@ -2060,6 +2582,7 @@ del_old_port(struct shash_node *sh_node)
             free_lag_id(portp->lag_id);
         }
         free(portp->name);
+        free(portp->bond_speed_str);
         free(portp);
         shash_delete(&all_ports, sh_node);
     }
@@ -2126,60 +2649,76 @@ add_new_port(const struct ovsrec_port *port_row)
  * data from OVSDB.
  * Takes necessary actions to propagate database changes.
  *
+ * Only the port rows the IDL tracked as inserted, modified or deleted
+ * since the last call are looked at.  As for interfaces, a row that is
+ * not cached yet is handled as new whatever the IDL reports.
+ *
  * @return positive integer if an ovsdb write is required 0 otherwise.
  */
 static int
 update_port_cache(void)
 {
-    struct shash sh_idl_ports;
     const struct ovsrec_port *row;
     struct shash_node *sh_node, *sh_next;
+    struct shash added = SHASH_INITIALIZER(&added);
+    bool rows_deleted = false;
     int rc = 0;
 
-    /* Collect all the ports in the DB. */
-    shash_init(&sh_idl_ports);
-    OVSREC_PORT_FOR_EACH(row, idl) {
-        if (!shash_add_once(&sh_idl_ports, row->name, row)) {
-            VLOG_WARN("port %s specified twice", row->name);
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        if (ovsrec_port_is_deleted(row)) {
+            rows_deleted = true;
+            break;
         }
     }
 
-    /* Delete old ports. */
-    SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_ports) {
-        struct port_data *portp = shash_find_data(&sh_idl_ports, sh_node->name);
-        if (!portp) {
-            VLOG_DBG("Found a deleted port %s", sh_node->name);
-            del_old_port(sh_node);
-            rc++;
+    /* Delete old ports.  Only the row pointer of a deleted row is still
+     * usable, so match it against the cached rows. */
+    if (rows_deleted) {
+        SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_ports) {
+            struct port_data *portp = sh_node->data;
+            if (ovsrec_port_is_deleted(portp->cfg)) {
+                VLOG_DBG("Found a deleted port %s", sh_node->name);
+                del_old_port(sh_node);
+                rc++;
+            }
         }
     }
 
     /* Add new ports. */
-    SHASH_FOR_EACH(sh_node, &sh_idl_ports) {
-        struct port_data *portp = shash_find_data(&all_ports, sh_node->name);
-        if (!portp) {
-            VLOG_DBG("Found an added port %s", sh_node->name);
-            add_new_port(sh_node->data);
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        if (!ovsrec_port_is_deleted(row) &&
+            !shash_find_data(&all_ports, row->name)) {
+            VLOG_DBG("Found an added port %s", row->name);
+            add_new_port(row);
+            shash_add_once(&added, row->name, row);
         }
     }
 
     /* Check for changes in the port row entries. */
-    SHASH_FOR_EACH(sh_node, &all_ports) {
-        const struct ovsrec_port *row = shash_find_data(&sh_idl_ports,
-                                                        sh_node->name);
-        /* Check for changes to row. */
-        if (OVSREC_IDL_IS_ROW_INSERTED(row, idl_seqno) ||
-            OVSREC_IDL_IS_ROW_MODIFIED(row, idl_seqno)) {
-            struct port_data *portp = sh_node->data;
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        struct port_data *portp;
 
-            if (OVSREC_IDL_IS_ROW_INSERTED(row, idl_seqno)) {
-                portp->timeout_mode = LACP_PORT_TIMEOUT_DEFAULT;
-            }
+        if (ovsrec_port_is_deleted(row)) {
+            continue;
+        }
 
-            /* Handle Port config update. */
-            if (handle_port_config(row, portp)) {
-                rc++;
-            }
+        portp = shash_find_data(&all_ports, row->name);
+        if (!portp) {
+            continue;
+        }
+
+        if (shash_find_data(&added, row->name)) {
+            portp->timeout_mode = LACP_PORT_TIMEOUT_DEFAULT;
+        } else if (!ovsrec_port_is_updated(row, OVSREC_PORT_COL_LACP) &&
+                   !ovsrec_port_is_updated(row, OVSREC_PORT_COL_INTERFACES) &&
+                   !ovsrec_port_is_updated(row,
+                                           OVSREC_PORT_COL_OTHER_CONFIG)) {
+            continue;
+        }
+
+        /* Handle Port config update. */
+        if (handle_port_config(row, portp)) {
+            rc++;
         }
     }
 
@@ -2188,8 +2727,7 @@ update_port_cache(void)
         shash_delete(&interfaces_recently_added, sh_node);
     }
 
-    /* Destroy the shash of the IDL ports. */
-    shash_destroy(&sh_idl_ports);
+    shash_destroy(&added);
 
     return rc;
 } /* update_port_cache */
@@ -2293,6 +2831,8 @@ lacpd_reconfigure(void)
 
     /* Update IDL sequence # after we've handled everything. */
     idl_seqno = new_idl_seqno;
+    ovsdb_idl_track_clear(idl);
+    view_dirty = true;
 
     return rc;
 } /* lacpd_reconfigure */
@@ -2319,7 +2859,7 @@ lacpd_chk_for_system_configured(void)
 } /* lacpd_chk_for_system_configured */
 
 static char *
-format_system_id(system_variables_t *system_id)
+format_system_id(const system_variables_t *system_id)
 {
     char *result = NULL;
     asprintf(&result, "%d,%02x:%02x:%02x:%02x:%02x:%02x",
@@ -2410,8 +2950,22 @@ db_clear_interface(struct iface_data *idp)
     remove_interface_bond_status_map_entry(idp);
 
     idp->lacp_current = false;
+    forget_interface_lacp_status(idp);
+
+    smap_destroy(&smap);
+}
+
+/* Forgets the lacp_status values last written for the interface, so the
+ * next update writes all of them. */
+static void
+forget_interface_lacp_status(struct iface_data *idp)
+{
     idp->lacp_current_set = false;
 
+    if (idp->index >= 0) {
+        status_invalidate(idp->index);
+    }
+
     free(idp->actor.system_id);
     idp->actor.system_id = NULL;
     free(idp->actor.port_id);
@@ -2429,116 +2983,261 @@ db_clear_interface(struct iface_data *idp)
     idp->partner.key = NULL;
     free(idp->partner.state);
     idp->partner.state = NULL;
+} /* forget_interface_lacp_status */
 
-    smap_destroy(&smap);
-}
+/* Forgets the port status values last written for the port, so the next
+ * db_set_port_status() writes all of them. */
+static void
+forget_port_status(struct port_data *portp)
+{
+    free(portp->speed_str);
+    portp->speed_str = NULL;
+    free(portp->bond_speed_str);
+    portp->bond_speed_str = NULL;
+    portp->current_status = STATUS_UNINITIALIZED;
+} /* forget_port_status */
+
+static bool
+system_id_equal(const system_variables_t *a, const system_variables_t *b)
+{
+    return (a->system_priority == b->system_priority &&
+            memcmp(a->system_mac_addr, b->system_mac_addr,
+                   sizeof(a->system_mac_addr)) == 0);
+} /* system_id_equal */
+
+static bool
+port_id_equal(const struct lacp_status_raw *a, const struct lacp_status_raw *b)
+{
+    return (a->port_priority == b->port_priority &&
+            a->port_number == b->port_number);
+} /* port_id_equal */
+
+static bool
+state_equal(state_parameters_t a, state_parameters_t b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+} /* state_equal */
+
+static bool
+lacp_status_raw_equal(const struct lacp_status_raw *a,
+                      const struct lacp_status_raw *b)
+{
+    return (system_id_equal(&a->system_id, &b->system_id) &&
+            port_id_equal(a, b) &&
+            a->key == b->key &&
+            state_equal(a->state, b->state));
+} /* lacp_status_raw_equal */
 
 void
 db_update_interface(lacp_per_port_variables_t *plpinfo)
 {
-    struct iface_data *idp = NULL;
     int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+    struct iface_status *st = &iface_status[port];
+    uint64_t bit = UINT64_C(1) << (port % POOL_WORD_BITS);
+    struct iface_status new;
+
+    new.actor.system_id = plpinfo->actor_oper_system_variables;
+    new.actor.port_priority = plpinfo->actor_oper_port_priority;
+    new.actor.port_number = plpinfo->actor_oper_port_number;
+    new.actor.key = plpinfo->actor_oper_port_key;
+    new.actor.state = plpinfo->actor_oper_port_state;
+
+    new.partner.system_id = plpinfo->partner_oper_system_variables;
+    new.partner.port_priority = plpinfo->partner_oper_port_priority;
+    new.partner.port_number = plpinfo->partner_oper_port_number;
+    new.partner.key = plpinfo->partner_oper_key;
+    new.partner.state = plpinfo->partner_oper_port_state;
+
+    new.lacp_current = (plpinfo->recv_fsm_state == RECV_FSM_CURRENT_STATE);
+    new.lag_port_type = plpinfo->lag ? (int)plpinfo->lag->port_type : -1;
+    new.valid = true;
+
+    pthread_mutex_lock(&status_mutex);
+
+    /* Most FSM steps don't change what is published. */
+    if (st->valid &&
+        st->lacp_current == new.lacp_current &&
+        st->lag_port_type == new.lag_port_type &&
+        lacp_status_raw_equal(&st->actor, &new.actor) &&
+        lacp_status_raw_equal(&st->partner, &new.partner)) {
+        pthread_mutex_unlock(&status_mutex);
+        return;
+    }
+
+    *st = new;
+
+    if (!(status_dirty[port / POOL_WORD_BITS] & bit)) {
+        status_dirty[port / POOL_WORD_BITS] |= bit;
+        if (status_n_dirty++ == 0) {
+            seq_change(status_seq);
+        }
+    }
+
+    pthread_mutex_unlock(&status_mutex);
+} /* db_update_interface */
+
+/* Makes the next update for interface index 'port' go through to the
+ * status writer even if it matches the last one, e.g. because that
+ * one could not be written or the row has been cleared since. */
+static void
+status_invalidate(int port)
+{
+    pthread_mutex_lock(&status_mutex);
+    iface_status[port].valid = false;
+    pthread_mutex_unlock(&status_mutex);
+} /* status_invalidate */
+
+/* Makes the status writer write the last status reported for interface
+ * index 'port' again, after the write of it failed. */
+static void
+status_retry(int port)
+{
+    uint64_t bit = UINT64_C(1) << (port % POOL_WORD_BITS);
+
+    pthread_mutex_lock(&status_mutex);
+    iface_status[port].valid = false;
+    if (!(status_dirty[port / POOL_WORD_BITS] & bit)) {
+        status_dirty[port / POOL_WORD_BITS] |= bit;
+        if (status_n_dirty++ == 0) {
+            seq_change(status_seq);
+        }
+    }
+    pthread_mutex_unlock(&status_mutex);
+} /* status_retry */
+
+/* Drops any status of interface index 'port' not yet written. */
+static void
+status_forget_interface(int port)
+{
+    uint64_t bit = UINT64_C(1) << (port % POOL_WORD_BITS);
+
+    pthread_mutex_lock(&status_mutex);
+    if (status_dirty[port / POOL_WORD_BITS] & bit) {
+        status_dirty[port / POOL_WORD_BITS] &= ~bit;
+        status_n_dirty--;
+    }
+    pthread_mutex_unlock(&status_mutex);
+} /* status_forget_interface */
+
+/* Writes the LACP status of interface index 'port' into the open
+ * status transaction.  Returns true if anything changed.  Values are
+ * compared in binary against what was last written, and only the
+ * fields that differ are formatted. */
+static bool
+db_write_interface_status(int port, const struct iface_status *st)
+{
+    struct iface_data *idp = NULL;
     const struct ovsrec_interface *ifrow;
     bool lacp_current;
-    struct ovsdb_idl_txn *txn = NULL;
     bool changes = false;
-    bool smap_changes = false;
+    bool actor_changed, partner_changed;
+    unsigned int speed;
     char *system_id, *port_id, *key, *state;
-    struct smap smap;
     struct port_data *portp;
 
-    OVSDB_LOCK;
-
     /* get interface data */
     idp = find_iface_data_by_index(port);
 
     if (idp == NULL) {
         VLOG_WARN("Unable to find interface for hardware index %d", port);
-        goto end;
+        status_invalidate(port);
+        return false;
     }
 
     portp = idp->port_datap;
 
     if (!portp) {
         VLOG_WARN("Interface doesn't have any port");
-        goto end;
+        status_invalidate(port);
+        return false;
     }
 
     if (portp->lacp_mode == PORT_LACP_OFF) {
         VLOG_WARN("Interface lacp mode is off");
-        goto end;
+        status_invalidate(port);
+        return false;
     }
 
-    idp->local_state = plpinfo->actor_oper_port_state;
+    idp->local_state = st->actor.state;
 
-    ifrow = idp->cfg;
+    speed = portp->lag_member_speed;
+    if (st->lag_port_type != -1) {
+        speed = lport_type_to_speed(ntohs(st->lag_port_type));
+    }
 
-    txn = ovsdb_idl_txn_create(idl);
+    actor_changed = (idp->actor.system_id == NULL ||
+                     idp->actor.port_id == NULL ||
+                     idp->actor.key == NULL ||
+                     idp->actor.state == NULL ||
+                     !lacp_status_raw_equal(&idp->actor_raw, &st->actor));
+    partner_changed = (idp->partner.system_id == NULL ||
+                       idp->partner.port_id == NULL ||
+                       idp->partner.key == NULL ||
+                       idp->partner.state == NULL ||
+                       !lacp_status_raw_equal(&idp->partner_raw, &st->partner));
+
+    if (!actor_changed && !partner_changed &&
+        idp->lacp_current_set && idp->lacp_current == st->lacp_current &&
+        speed == portp->lag_member_speed) {
+        return false;
+    }
 
-    smap_clone(&smap, &ifrow->lacp_status);
+    ifrow = idp->cfg;
 
     /* actor data */
-    system_id = format_system_id(&plpinfo->actor_oper_system_variables);
-    port_id = format_port_id(plpinfo->actor_oper_port_priority, plpinfo->actor_oper_port_number);
-    key = format_key(plpinfo->actor_oper_port_key);
-    state = format_state(plpinfo->actor_oper_port_state);
-
     if (idp->actor.system_id == NULL ||
-        strcmp(idp->actor.system_id, system_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_SYSTEM_ID, system_id);
+        !system_id_equal(&idp->actor_raw.system_id, &st->actor.system_id)) {
+        system_id = format_system_id(&st->actor.system_id);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_ACTOR_SYSTEM_ID, system_id);
         free(idp->actor.system_id);
         idp->actor.system_id = system_id;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:actor_system_id = %s)",
             idp->name, system_id);
-    } else {
-        free(system_id);
     }
 
     if (idp->actor.port_id == NULL ||
-        strcmp(idp->actor.port_id, port_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_PORT_ID, port_id);
+        !port_id_equal(&idp->actor_raw, &st->actor)) {
+        port_id = format_port_id(st->actor.port_priority, st->actor.port_number);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_ACTOR_PORT_ID, port_id);
         free(idp->actor.port_id);
         idp->actor.port_id = port_id;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:actor_port_id = %s)",
             idp->name, port_id);
-    } else {
-        free(port_id);
     }
 
-    if (idp->actor.key == NULL ||
-        strcmp(idp->actor.key, key) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_KEY, key);
+    if (idp->actor.key == NULL || idp->actor_raw.key != st->actor.key) {
+        key = format_key(st->actor.key);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_ACTOR_KEY, key);
         free(idp->actor.key);
         idp->actor.key = key;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:actor_key = %s)",
             idp->name, key);
-    } else {
-        free(key);
     }
 
     if (idp->actor.state == NULL ||
-        strcmp(idp->actor.state, state) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_STATE, state);
+        !state_equal(idp->actor_raw.state, st->actor.state)) {
+        state = format_state(st->actor.state);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_ACTOR_STATE, state);
         free(idp->actor.state);
         idp->actor.state = state;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:actor_state = %s)",
             idp->name, state);
-    } else {
-        free(state);
     }
 
-    /* partner data */
-    system_id = format_system_id(&plpinfo->partner_oper_system_variables);
-    port_id = format_port_id(plpinfo->partner_oper_port_priority, plpinfo->partner_oper_port_number);
-    key = format_key(plpinfo->partner_oper_key);
-    state = format_state(plpinfo->partner_oper_port_state);
+    idp->actor_raw = st->actor;
 
+    /* partner data */
     if (idp->partner.system_id == NULL ||
-        strcmp(idp->partner.system_id, system_id) != 0) {
+        !system_id_equal(&idp->partner_raw.system_id, &st->partner.system_id)) {
+        system_id = format_system_id(&st->partner.system_id);
         if (strncmp(system_id, NO_SYSTEM_ID, strlen(NO_SYSTEM_ID))) {
             if (portp &&
                 log_event("LACP_PARTNER_DETECTED",
@@ -2551,61 +3250,54 @@ db_update_interface(lacp_per_port_variables_t *plpinfo)
             }
         }
 
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_SYSTEM_ID, system_id);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_PARTNER_SYSTEM_ID, system_id);
         free(idp->partner.system_id);
         idp->partner.system_id = system_id;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:partner_system_id = %s)",
             idp->name, system_id);
-    } else {
-        free(system_id);
     }
 
     if (idp->partner.port_id == NULL ||
-        strcmp(idp->partner.port_id, port_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_PORT_ID, port_id);
+        !port_id_equal(&idp->partner_raw, &st->partner)) {
+        port_id = format_port_id(st->partner.port_priority, st->partner.port_number);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_PARTNER_PORT_ID, port_id);
         free(idp->partner.port_id);
         idp->partner.port_id = port_id;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:partner_port_id = %s)",
             idp->name, port_id);
-    } else {
-        free(port_id);
     }
 
-    if (idp->partner.key == NULL ||
-        strcmp(idp->partner.key, key) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_KEY, key);
+    if (idp->partner.key == NULL || idp->partner_raw.key != st->partner.key) {
+        key = format_key(st->partner.key);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_PARTNER_KEY, key);
         free(idp->partner.key);
         idp->partner.key = key;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:partner_key = %s)",
             idp->name, key);
-    } else {
-        free(key);
     }
 
     if (idp->partner.state == NULL ||
-        strcmp(idp->partner.state, state) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_STATE, state);
+        !state_equal(idp->partner_raw.state, st->partner.state)) {
+        state = format_state(st->partner.state);
+        ovsrec_interface_update_lacp_status_setkey(
+            ifrow, INTERFACE_LACP_STATUS_MAP_PARTNER_STATE, state);
         free(idp->partner.state);
         idp->partner.state = state;
-        smap_changes = true;
+        changes = true;
         VLOG_DBG("updating interface %s (lacp_status:partner_state = %s)",
             idp->name, state);
-    } else {
-        free(state);
-    }
-
-    if (smap_changes) {
-        ovsrec_interface_set_lacp_status(ifrow, &smap);
-        changes = true;
     }
 
-    smap_destroy(&smap);
+    idp->partner_raw = st->partner;
 
     /* lacp_current data */
-    lacp_current = (plpinfo->recv_fsm_state == RECV_FSM_CURRENT_STATE);
+    lacp_current = st->lacp_current;
 
     if (idp->lacp_current_set == false || idp->lacp_current != lacp_current) {
         ovsrec_interface_set_lacp_current(ifrow, &lacp_current, 1);
@@ -2616,57 +3308,234 @@ db_update_interface(lacp_per_port_variables_t *plpinfo)
         idp->lacp_current_set = true;
     }
 
+    set_lag_member_speed(portp, speed);
+
+    if (db_set_port_status(portp)) {
+        changes = true;
+    }
+
+    return changes;
+} /* db_write_interface_status */
+
+/* Returns true if a transaction that completed with 'status' did not
+ * get its changes into the database. */
+static bool
+txn_failed(enum ovsdb_idl_txn_status status)
+{
+    return (status != TXN_SUCCESS && status != TXN_UNCHANGED &&
+            status != TXN_INCOMPLETE);
+} /* txn_failed */
+
+/* Finishes the in flight status transaction, if any, and records its
+ * metrics.  If it failed, the interfaces it carried are written again
+ * in full.  Called with OVSDB_LOCK held. */
+static void
+status_txn_done(enum ovsdb_idl_txn_status status)
+{
+    long long latency = time_msec() - status_txn_start;
+    int i;
+
+    if (txn_failed(status)) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_WARN_RL(&rl, "LACP status update failed: %s",
+                     ovsdb_idl_txn_status_to_string(status));
+        status_n_failed++;
+
+        for (i = 0; i < status_txn_n; i++) {
+            struct iface_data *idp = find_iface_data_by_index(status_batch[i]);
+
+            if (idp) {
+                forget_interface_lacp_status(idp);
+                if (idp->port_datap) {
+                    forget_port_status(idp->port_datap);
+                }
+            }
+            status_retry(status_batch[i]);
+        }
+    }
+
+    status_n_commits++;
+    status_last_latency = latency;
+    status_total_latency += latency;
+    if (latency > status_max_latency) {
+        status_max_latency = latency;
+    }
+
+    ovsdb_idl_txn_destroy(status_txn);
+    status_txn = NULL;
+} /* status_txn_done */
+
+/* Blocks until the in flight status transaction, if any, completes.
+ * Must be called with OVSDB_LOCK held before creating any other
+ * transaction, since the IDL allows only one at a time. */
+static void
+status_txn_complete(void)
+{
+    if (status_txn) {
+        status_txn_done(ovsdb_idl_txn_commit_block(status_txn));
+    }
+} /* status_txn_complete */
+
+/* Writes out the dirty interface status, at most once per
+ * status_interval.  Called from the OVS thread with OVSDB_LOCK held. */
+static void
+status_writer_run(void)
+{
+    long long now = time_msec();
+    bool changes = false;
+    int n = 0;
+    int i, w;
+
+    if (status_txn) {
+        enum ovsdb_idl_txn_status status = ovsdb_idl_txn_commit(status_txn);
+
+        if (status == TXN_INCOMPLETE) {
+            return;
+        }
+        status_txn_done(status);
+    }
+
+    status_seqno = seq_read(status_seq);
+
+    if (now < status_next_flush) {
+        return;
+    }
+
+    /* Take the dirty set, so the protocol thread can carry on. */
+    pthread_mutex_lock(&status_mutex);
+    for (w = 0; w < POOL_WORD_BITS; w++) {
+        uint64_t bits = status_dirty[w];
+
+        while (bits) {
+            int port = w * POOL_WORD_BITS + __builtin_ffsll(bits) - 1;
+
+            status_batch[n] = port;
+            status_batch_data[n] = iface_status[port];
+            n++;
+            bits &= bits - 1;
+        }
+        status_dirty[w] = 0;
+    }
+    status_n_dirty = 0;
+    pthread_mutex_unlock(&status_mutex);
+
+    if (n == 0) {
+        return;
+    }
+
+    status_txn = ovsdb_idl_txn_create(idl);
+    status_txn_start = now;
+    status_txn_n = n;
+
+    for (i = 0; i < n; i++) {
+        if (db_write_interface_status(status_batch[i], &status_batch_data[i])) {
+            changes = true;
+        }
+    }
+
+    status_n_updates += n;
+    status_last_batch = n;
+    if (n > status_max_batch) {
+        status_max_batch = n;
+    }
+    status_next_flush = now + status_interval;
+
     if (changes) {
-        ovsdb_idl_txn_commit_block(txn);
+        enum ovsdb_idl_txn_status status = ovsdb_idl_txn_commit(status_txn);
+
+        if (status != TXN_INCOMPLETE) {
+            status_txn_done(status);
+        }
     } else {
-        ovsdb_idl_txn_abort(txn);
+        ovsdb_idl_txn_abort(status_txn);
+        ovsdb_idl_txn_destroy(status_txn);
+        status_txn = NULL;
     }
-    ovsdb_idl_txn_destroy(txn);
+} /* status_writer_run */
 
-    if (portp) {
-        if (plpinfo->lag != NULL) {
-            portp->lag_member_speed = lport_type_to_speed(ntohs(plpinfo->lag->port_type));
-        }
-        db_update_port_status(portp);
+static void
+status_writer_wait(void)
+{
+    bool dirty;
+
+    if (status_txn) {
+        ovsdb_idl_txn_wait(status_txn);
+        return;
     }
 
-end:
-    OVSDB_UNLOCK;
-} /* db_update_interface */
+    pthread_mutex_lock(&status_mutex);
+    dirty = (status_n_dirty != 0);
+    pthread_mutex_unlock(&status_mutex);
+
+    if (dirty) {
+        poll_timer_wait_until(status_next_flush);
+    } else {
+        seq_wait(status_seq, status_seqno);
+    }
+} /* status_writer_wait */
+
+void
+lacpd_set_status_interval(int interval)
+{
+    status_interval = (interval > 0) ? interval : 0;
+} /* lacpd_set_status_interval */
 
 /**********************************************************************
- * Pool implementation: this is diferrent from the LAG pool manager.
- * This is currently only used for allocating interface indexes.
+ * Pool implementation: used for allocating interface indexes and
+ * LAG IDs.  Allocation returns the lowest free index.
  **********************************************************************/
-int
-allocate_next(unsigned char *pool, int size)
+static void
+init_index_pool(struct index_pool *pool, int size)
 {
-    int idx = 0;
+    int w;
 
-    while (pool[idx] == 0xff && (idx * BITS_PER_BYTE) < size) {
-        idx++;
-    }
+    memset(pool, 0, sizeof(*pool));
 
-    if ((idx * BITS_PER_BYTE) < size) {
-        idx *= BITS_PER_BYTE;
+    if (size > MAX_ENTRIES_IN_POOL) {
+        size = MAX_ENTRIES_IN_POOL;
+    }
 
-        while (idx < size && !IS_AVAILABLE(pool, idx)) {
-            idx++;
+    for (w = 0; w * POOL_WORD_BITS < size; w++) {
+        if (size - w * POOL_WORD_BITS >= POOL_WORD_BITS) {
+            pool->free[w] = UINT64_MAX;
+        } else {
+            pool->free[w] = (UINT64_C(1) << (size - w * POOL_WORD_BITS)) - 1;
         }
+        pool->summary |= UINT64_C(1) << w;
+    }
+} /* init_index_pool */
 
-        if (idx < size && IS_AVAILABLE(pool, idx)) {
-            SET(pool, idx);
-            return idx;
-        }
+static int
+allocate_next(struct index_pool *pool)
+{
+    int w, b;
+
+    if (pool->summary == 0) {
+        return -1;
+    }
+
+    w = __builtin_ffsll(pool->summary) - 1;
+    b = __builtin_ffsll(pool->free[w]) - 1;
+
+    pool->free[w] &= ~(UINT64_C(1) << b);
+    if (pool->free[w] == 0) {
+        pool->summary &= ~(UINT64_C(1) << w);
     }
 
-    return -1;
+    return w * POOL_WORD_BITS + b;
 } /* allocate_next */
 
 static void
-free_index(unsigned char *pool, int idx)
+free_index(struct index_pool *pool, int idx)
 {
-    CLEAR(pool, idx);
+    int w = idx / POOL_WORD_BITS;
+
+    if (idx < 0 || idx >= MAX_ENTRIES_IN_POOL) {
+        return;
+    }
+
+    pool->free[w] |= UINT64_C(1) << (idx % POOL_WORD_BITS);
+    pool->summary |= UINT64_C(1) << w;
 } /* free_index */
 
 /**@} end of lacpd_ovsdb_if group */
@@ -2700,14 +3569,32 @@ lacpd_run(void)
     lacpd_chk_for_system_configured();
 
     if (system_configured) {
-        txn = ovsdb_idl_txn_create(idl);
-        if (lacpd_reconfigure()) {
-            /* Some OVSDB write needs to happen. */
-            ovsdb_idl_txn_commit_block(txn);
+        /* Members that lost their link stop transmitting first. */
+        fast_tx_disable_run();
+
+        /* Only wait for the status transaction in flight when there is
+         * configuration to handle, status_writer_run() polls it
+         * otherwise. */
+        if (ovsdb_idl_get_seqno(idl) != idl_seqno) {
+            status_txn_complete();
+            txn = ovsdb_idl_txn_create(idl);
+            if (lacpd_reconfigure()) {
+                /* Some OVSDB write needs to happen. */
+                ovsdb_idl_txn_commit_block(txn);
+            }
+            ovsdb_idl_txn_destroy(txn);
         }
-        ovsdb_idl_txn_destroy(txn);
     }
 
+    /* Apply the state changes queued by the protocol thread, then write
+     * out the LACP status it reported. */
+    delta_channel_run();
+    db_rewrite_run();
+    status_writer_run();
+
+    /* Let the appctl thread see the result of this pass. */
+    view_run();
+
     OVSDB_UNLOCK;
 
     return;
@@ -2718,33 +3605,188 @@ lacpd_wait(void)
 {
     ovsdb_idl_wait(idl);
     poll_timer_wait(LACP_POLL_INTERVAL);
+
+    OVSDB_LOCK;
+    delta_channel_wait();
+    fast_tx_disable_wait();
+    status_writer_wait();
+    if (db_rewrite_pending) {
+        poll_timer_wait_until(db_rewrite_next);
+    }
+    OVSDB_UNLOCK;
 } /* lacpd_wait */
 
 /**********************************************************************/
 /* Interface attach/detach functions called from LACP state machine.  */
+/*                                                                    */
+/* These run on the protocol thread and only queue a delta; see       */
+/* delta_channel_run() for where the OVS thread applies them.         */
 /**********************************************************************/
 static void
-lacpd_thread_intf_update_hw_bond_config(struct iface_data *idp,
-                                        bool update_rx, bool rx_enabled,
-                                        bool update_tx, bool tx_enabled)
+delta_post(const struct lacp_delta *delta)
 {
-    struct ovsdb_idl_txn *txn;
+    if (!delta_held) {
+        pthread_mutex_lock(&delta_mutex);
+    }
 
-    OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
-    if (update_rx) {
-        update_interface_hw_bond_config_map_entry(
-            idp,
-            INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
-            (rx_enabled ?
-             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
-             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
+    if (delta_n_pending == delta_pending_allocated) {
+        delta_pending_allocated = (delta_pending_allocated
+                                   ? 2 * delta_pending_allocated : 64);
+        delta_pending = xrealloc(delta_pending,
+                                 delta_pending_allocated * sizeof *delta_pending);
+    }
+    delta_pending[delta_n_pending++] = *delta;
 
-        update_member_interface_bond_status(idp->port_datap);
-        update_port_bond_status_map_entry(idp->port_datap);
+    if (delta_n_pending == 1) {
+        seq_change(delta_seq);
     }
-    if (update_tx) {
-        update_interface_hw_bond_config_map_entry(
+
+    if (!delta_held) {
+        pthread_mutex_unlock(&delta_mutex);
+    }
+} /* delta_post */
+
+/**
+ * @details
+ * Keeps the OVS thread from taking the queued deltas until
+ * lacpd_delta_release(), so the deltas posted in between are applied in
+ * the same transaction.  Called from a protocol thread.  The OVS thread
+ * may wait for the hold with OVSDB_LOCK held, so keep it short.
+ */
+void
+lacpd_delta_hold(void)
+{
+    pthread_mutex_lock(&delta_mutex);
+    delta_held = true;
+} /* lacpd_delta_hold */
+
+void
+lacpd_delta_release(void)
+{
+    delta_held = false;
+    pthread_mutex_unlock(&delta_mutex);
+} /* lacpd_delta_release */
+
+static void
+delta_post_port(enum lacp_delta_type type, uint16_t lag_id, int port,
+                lacp_per_port_variables_t *plpinfo)
+{
+    struct lacp_delta delta;
+
+    memset(&delta, 0, sizeof delta);
+    delta.type = type;
+    delta.lag_id = lag_id;
+    delta.port = port;
+    delta.lag_port_type = -1;
+
+    if (plpinfo) {
+        delta.port = PM_HANDLE2PORT(plpinfo->lport_handle);
+        delta.actor_state = plpinfo->actor_oper_port_state;
+        if (plpinfo->lag != NULL) {
+            delta.lag_port_type = (int)plpinfo->lag->port_type;
+        }
+    }
+
+    delta_post(&delta);
+} /* delta_post_port */
+
+/* Called from a protocol thread, after the side effects of everything
+ * queued for it before the ml_sync_shard() request are out. */
+void
+lacpd_shard_synced(int port, unsigned int seq)
+{
+    struct lacp_delta delta;
+
+    VLOG_DBG("%s: port=%d, seq=%u", __FUNCTION__, port, seq);
+
+    memset(&delta, 0, sizeof delta);
+    delta.type = LACP_DELTA_SHARD_SYNCED;
+    delta.port = port;
+    delta.lag_port_type = -1;
+    delta.seq = seq;
+
+    delta_post(&delta);
+} /* lacpd_shard_synced */
+
+/* Called from the LACPDU RX thread. */
+void
+lacpd_link_state_resync(int port)
+{
+    VLOG_DBG("%s: port=%d", __FUNCTION__, port);
+
+    delta_post_port(LACP_DELTA_LINK_RESYNC, 0, port, NULL);
+} /* lacpd_link_state_resync */
+
+void
+ops_attach_port_in_hw(uint16_t lag_id, int port)
+{
+    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+
+    delta_post_port(LACP_DELTA_HW_ATTACH, lag_id, port, NULL);
+} /* ops_attach_port_in_hw */
+
+void
+ops_detach_port_in_hw(uint16_t lag_id, int port)
+{
+    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+
+    delta_post_port(LACP_DELTA_HW_DETACH, lag_id, port, NULL);
+} /* ops_detach_port_in_hw */
+
+void
+ops_trunk_port_egr_enable(uint16_t lag_id, int port)
+{
+    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+
+    delta_post_port(LACP_DELTA_HW_EGRESS_ENABLE, lag_id, port, NULL);
+} /* ops_trunk_port_egr_enable */
+
+void
+db_add_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+{
+    delta_post_port(LACP_DELTA_LAG_PORT_ADD, lag_id, port, plpinfo);
+} /* db_add_lag_port */
+
+void
+db_delete_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+{
+    delta_post_port(LACP_DELTA_LAG_PORT_DELETE, lag_id, port, plpinfo);
+} /* db_delete_lag_port */
+
+void
+db_update_lag_partner_info(uint16_t lag_id)
+{
+    delta_post_port(LACP_DELTA_PARTNER_UPDATE, lag_id, -1, NULL);
+} /* db_update_lag_partner_info */
+
+void
+db_clear_lag_partner_info(uint16_t lag_id)
+{
+    delta_post_port(LACP_DELTA_PARTNER_CLEAR, lag_id, -1, NULL);
+} /* db_clear_lag_partner_info */
+
+/**********************************************************************/
+/* Delta handlers.  These run on the OVS thread with OVSDB_LOCK held  */
+/* and write into the delta transaction.                              */
+/**********************************************************************/
+static void
+delta_intf_update_hw_bond_config(struct iface_data *idp,
+                                 bool update_rx, bool rx_enabled,
+                                 bool update_tx, bool tx_enabled)
+{
+    if (update_rx) {
+        update_interface_hw_bond_config_map_entry(
+            idp,
+            INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
+            (rx_enabled ?
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
+
+        update_member_interface_bond_status(idp->port_datap);
+        update_port_bond_status_map_entry(idp->port_datap);
+    }
+    if (update_tx) {
+        update_interface_hw_bond_config_map_entry(
             idp,
             INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
             (tx_enabled ?
@@ -2754,114 +3796,118 @@ lacpd_thread_intf_update_hw_bond_config(struct iface_data *idp,
         update_member_interface_bond_status(idp->port_datap);
         update_port_bond_status_map_entry(idp->port_datap);
     }
+} /* delta_intf_update_hw_bond_config */
 
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    OVSDB_UNLOCK;
-
-} /* ops_intf_update_hw_bond_config */
-
-void
-ops_attach_port_in_hw(uint16_t lag_id, int port)
+static bool
+delta_hw_attach(const struct lacp_delta *delta)
 {
-    struct iface_data *idp = NULL;
-
-    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
 
-    idp = find_iface_data_by_index(port);
     if (idp) {
         if (idp->lacp_state == LACP_STATE_ENABLED) {
             /* Attaching port means just RX. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    true,   /* update_rx */
-                                                    true,   /* rx_enabled */
-                                                    false,  /* update_tx */
-                                                    false); /* tx_enabled */
+            delta_intf_update_hw_bond_config(idp,
+                                             true,   /* update_rx */
+                                             true,   /* rx_enabled */
+                                             false,  /* update_tx */
+                                             false); /* tx_enabled */
+            return true;
         } else {
             VLOG_ERR("LACP state machine trying to attach port %d "
-                     "when LACP is not enabled!", port);
+                     "when LACP is not enabled!", delta->port);
         }
     } else {
         VLOG_ERR("Failed to find interface data for attaching port in hw. "
-                 "port index=%d", port);
+                 "port index=%d", delta->port);
     }
-} /* ops_attach_port_in_hw */
 
-void
-ops_detach_port_in_hw(uint16_t lag_id, int port)
-{
-    struct iface_data *idp = NULL;
+    return false;
+} /* delta_hw_attach */
 
-    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+static bool
+delta_hw_detach(const struct lacp_delta *delta)
+{
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
 
-    idp = find_iface_data_by_index(port);
     if (idp) {
         if (idp->lacp_state == LACP_STATE_ENABLED) {
             /* Detaching port means both RX/TX are disabled. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    true,   /* update_rx */
-                                                    false,  /* rx_enabled */
-                                                    true,   /* update_tx */
-                                                    false); /* tx_enabled */
+            delta_intf_update_hw_bond_config(idp,
+                                             true,   /* update_rx */
+                                             false,  /* rx_enabled */
+                                             true,   /* update_tx */
+                                             false); /* tx_enabled */
+            return true;
         } else {
             /* Probably just a race condition between static <-> dynamic
              * LAG conversion.  Ignore the request. */
             VLOG_DBG("Ignoring detach port request from LACP state "
-                     "machine. LACP is not enabled on %d", port);
+                     "machine. LACP is not enabled on %d", delta->port);
         }
     } else {
         VLOG_ERR("Failed to find interface data for attaching port in hw. "
-                 "port index=%d", port);
+                 "port index=%d", delta->port);
     }
 
-} /* ops_detach_port_in_hw */
+    return false;
+} /* delta_hw_detach */
 
-void
-ops_trunk_port_egr_enable(uint16_t lag_id, int port)
+static bool
+delta_hw_egress_enable(const struct lacp_delta *delta)
 {
-    struct iface_data *idp = NULL;
-
-    VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
 
-    idp = find_iface_data_by_index(port);
     if (idp) {
         if (idp->lacp_state == LACP_STATE_ENABLED) {
             /* Egress enable means TX. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    false, /* update_rx */
-                                                    false, /* rx_enabled */
-                                                    true,  /* update_tx */
-                                                    true); /* tx_enabled */
+            delta_intf_update_hw_bond_config(idp,
+                                             false, /* update_rx */
+                                             false, /* rx_enabled */
+                                             true,  /* update_tx */
+                                             true); /* tx_enabled */
+            return true;
         } else {
             VLOG_ERR("LACP state machine trying to enable egress on "
-                     "port %d when LACP is not enabled!", port);
+                     "port %d when LACP is not enabled!", delta->port);
         }
     } else {
         VLOG_ERR("Failed to find interface data for egress enable. "
-                 "port index=%d", port);
+                 "port index=%d", delta->port);
     }
-} /* ops_trunk_port_egr_enable */
 
+    return false;
+} /* delta_hw_egress_enable */
+
+/* Sets the link speed of the LAG's members, as shown by the view. */
 static void
-db_update_port_status(struct port_data *portp)
+set_lag_member_speed(struct port_data *portp, unsigned int speed)
+{
+    if (portp->lag_member_speed != speed) {
+        portp->lag_member_speed = speed;
+        view_dirty = true;
+    }
+} /* set_lag_member_speed */
+
+/* Writes the port's LACP status into the open transaction.  Returns
+ * true if anything changed. */
+static bool
+db_set_port_status(struct port_data *portp)
 {
     const struct ovsrec_port *prow;
-    struct smap smap;
-    struct ovsdb_idl_txn *txn;
     bool changed = false;
     char *speed_str;
 
     prow = portp->cfg;
 
-    smap_clone(&smap, &prow->lacp_status);
-
     if (portp->lacp_mode == PORT_LACP_OFF && portp->current_status != STATUS_LACP_DISABLED)
     {
-        smap_remove(&smap, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
-        smap_remove(&smap, PORT_LACP_STATUS_MAP_BOND_STATUS);
+        ovsrec_port_update_lacp_status_delkey(
+            prow, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
+        ovsrec_port_update_lacp_status_delkey(
+            prow, PORT_LACP_STATUS_MAP_BOND_STATUS);
 
         if (shash_count(&portp->participant_ifs) == 0) {
-            portp->lag_member_speed = 0;
+            set_lag_member_speed(portp, 0);
         }
 
         portp->current_status = STATUS_LACP_DISABLED;
@@ -2873,15 +3919,15 @@ db_update_port_status(struct port_data *portp)
             VLOG_WARN("Port %s isn't operational - no interfaces working",
                       portp->name);
 
-            smap_replace(&smap,
-                         PORT_LACP_STATUS_MAP_BOND_STATUS_REASON,
-                         "No operational interfaces in bond");
+            ovsrec_port_update_lacp_status_setkey(
+                prow, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON,
+                "No operational interfaces in bond");
 
-            smap_replace(&smap,
-                         PORT_LACP_STATUS_MAP_BOND_STATUS,
-                         PORT_LACP_STATUS_BOND_STATUS_DOWN);
+            ovsrec_port_update_lacp_status_setkey(
+                prow, PORT_LACP_STATUS_MAP_BOND_STATUS,
+                PORT_LACP_STATUS_BOND_STATUS_DOWN);
 
-            portp->lag_member_speed = 0;
+            set_lag_member_speed(portp, 0);
 
             portp->current_status = STATUS_DOWN;
             changed = true;
@@ -2898,25 +3944,25 @@ db_update_port_status(struct port_data *portp)
 
         if (idp->local_state.defaulted) {
             if (portp->current_status != STATUS_DEFAULTED) {
-                smap_replace(&smap,
-                             PORT_LACP_STATUS_MAP_BOND_STATUS_REASON,
-                             "Remote LACP not responding on interfaces");
+                ovsrec_port_update_lacp_status_setkey(
+                    prow, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON,
+                    "Remote LACP not responding on interfaces");
 
-                smap_replace(&smap,
-                             PORT_LACP_STATUS_MAP_BOND_STATUS,
-                             PORT_LACP_STATUS_BOND_STATUS_DEFAULTED);
+                ovsrec_port_update_lacp_status_setkey(
+                    prow, PORT_LACP_STATUS_MAP_BOND_STATUS,
+                    PORT_LACP_STATUS_BOND_STATUS_DEFAULTED);
 
                 portp->current_status = STATUS_DEFAULTED;
                 changed = true;
             }
         } else {
             if (portp->current_status != STATUS_UP) {
-                smap_remove(&smap,
-                            PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
+                ovsrec_port_update_lacp_status_delkey(
+                    prow, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
 
-                smap_replace(&smap,
-                             PORT_LACP_STATUS_MAP_BOND_STATUS,
-                             PORT_LACP_STATUS_BOND_STATUS_OK);
+                ovsrec_port_update_lacp_status_setkey(
+                    prow, PORT_LACP_STATUS_MAP_BOND_STATUS,
+                    PORT_LACP_STATUS_BOND_STATUS_OK);
 
                 portp->current_status = STATUS_UP;
                 changed = true;
@@ -2925,12 +3971,12 @@ db_update_port_status(struct port_data *portp)
     } else {
         /* more than one participant -> operational */
         if (portp->current_status != STATUS_UP) {
-            smap_remove(&smap,
-                        PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
+            ovsrec_port_update_lacp_status_delkey(
+                prow, PORT_LACP_STATUS_MAP_BOND_STATUS_REASON);
 
-            smap_replace(&smap,
-                         PORT_LACP_STATUS_MAP_BOND_STATUS,
-                         PORT_LACP_STATUS_BOND_STATUS_OK);
+            ovsrec_port_update_lacp_status_setkey(
+                prow, PORT_LACP_STATUS_MAP_BOND_STATUS,
+                PORT_LACP_STATUS_BOND_STATUS_OK);
 
             portp->current_status = STATUS_UP;
             changed = true;
@@ -2942,282 +3988,867 @@ db_update_port_status(struct port_data *portp)
     if (portp->speed_str == NULL || strcmp(speed_str, portp->speed_str) != 0) {
         free(portp->speed_str);
         portp->speed_str = speed_str;
-        smap_replace(&smap, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
+        ovsrec_port_update_lacp_status_setkey(
+            prow, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
         changed = true;
     } else {
         free(speed_str);
     }
 
     if (changed) {
-        txn = ovsdb_idl_txn_create(idl);
-
-        ovsrec_port_set_lacp_status(prow, &smap);
         update_port_bond_status_map_entry(portp);
-
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
     }
 
-    smap_destroy(&smap);
-} /* db_update_port_status */
+    return changed;
+} /* db_set_port_status */
 
-void
-db_add_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+static bool
+delta_lag_port_add(const struct lacp_delta *delta)
 {
     struct port_data *portp;
     struct iface_data *idp;
-    int index;
-
-    OVSDB_LOCK;
 
     /* get port data */
-    portp = find_port_data_by_lag_id(lag_id);
+    portp = find_port_data_by_lag_id(delta->lag_id);
 
     if (portp == NULL) {
-        VLOG_WARN("Port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+        VLOG_WARN("Port not configured for LACP! lag_id = %d", delta->lag_id);
+        return false;
     }
 
-    index = PM_HANDLE2PORT(plpinfo->lport_handle);
-    idp = find_iface_data_by_index(index);
+    idp = find_iface_data_by_index(delta->port);
 
     if (idp == NULL) {
         VLOG_WARN("Interface not configured in LAG. lag_id = %d, port = %d",
-                  lag_id, port);
-        goto end;
+                  delta->lag_id, delta->port);
+        return false;
     }
 
-    idp->local_state = plpinfo->actor_oper_port_state;
+    idp->local_state = delta->actor_state;
 
-    shash_add_once(&portp->participant_ifs, idp->name, idp);
+    if (shash_add_once(&portp->participant_ifs, idp->name, idp)) {
+        view_dirty = true;
+    }
 
-    VLOG_DBG("Added interface (%d) to lag (%d): %d participants", port, lag_id, (int)shash_count(&portp->participant_ifs));
+    VLOG_DBG("Added interface (%d) to lag (%d): %d participants", delta->port, delta->lag_id, (int)shash_count(&portp->participant_ifs));
 
-    if (plpinfo->lag != NULL) {
-        portp->lag_member_speed = lport_type_to_speed(ntohs(plpinfo->lag->port_type));
+    if (delta->lag_port_type != -1) {
+        set_lag_member_speed(portp,
+                             lport_type_to_speed(ntohs(delta->lag_port_type)));
         VLOG_DBG("setting speed: %d\n", portp->lag_member_speed);
     }
 
-    db_update_port_status(portp);
-end:
-    OVSDB_UNLOCK;
+    return db_set_port_status(portp);
+} /* delta_lag_port_add */
 
-} /* db_add_lag_port */
-
-void
-db_delete_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+static bool
+delta_lag_port_delete(const struct lacp_delta *delta)
 {
     struct port_data *portp;
     struct iface_data *idp;
     struct shash_node *node;
-    int index;
-    struct ovsdb_idl_txn *txn = NULL;
 
-    OVSDB_LOCK;
-
-    index = PM_HANDLE2PORT(plpinfo->lport_handle);
-    idp = find_iface_data_by_index(index);
+    idp = find_iface_data_by_index(delta->port);
 
     if (idp == NULL) {
         VLOG_WARN("Interface not configured in LAG. lag_id = %d, port = %d",
-                  lag_id, port);
-        goto end;
+                  delta->lag_id, delta->port);
+        return false;
     }
 
     /* get port data */
-    portp = find_port_data_by_lag_id(lag_id);
+    portp = find_port_data_by_lag_id(delta->lag_id);
 
     if (portp == NULL) {
-        VLOG_WARN("Port not configured for LACP! lag_id = %d", lag_id);
-        txn = ovsdb_idl_txn_create(idl);
-
+        VLOG_WARN("Port not configured for LACP! lag_id = %d", delta->lag_id);
         db_clear_interface(idp);
-
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
-
-        goto end;
+        return true;
     }
 
     node = shash_find(&portp->participant_ifs, idp->name);
     if (!node) {
-        VLOG_WARN("Interface %s is not in participant list for lag_id = %d", idp->name, lag_id);
-        goto end;
+        VLOG_WARN("Interface %s is not in participant list for lag_id = %d", idp->name, delta->lag_id);
+        return false;
     }
     shash_delete(&portp->participant_ifs, node);
+    view_dirty = true;
 
     VLOG_DBG("Removed interface (%d) from lag (%d): %d participants",
-             port, lag_id, (int)shash_count(&portp->participant_ifs));
+             delta->port, delta->lag_id, (int)shash_count(&portp->participant_ifs));
 
-    if (plpinfo->lag != NULL) {
-        portp->lag_member_speed = lport_type_to_speed(plpinfo->lag->port_type);
+    if (delta->lag_port_type != -1) {
+        set_lag_member_speed(portp, lport_type_to_speed(delta->lag_port_type));
         VLOG_DBG("setting speed: %d\n", portp->lag_member_speed);
     }
 
-    db_update_port_status(portp);
+    return db_set_port_status(portp);
+} /* delta_lag_port_delete */
 
-end:
-    OVSDB_UNLOCK;
+/* Port lacp_status keys written by lacpd. */
+static const char *const port_lacp_status_keys[] = {
+    PORT_LACP_STATUS_MAP_BOND_STATUS,
+    PORT_LACP_STATUS_MAP_BOND_STATUS_REASON,
+    PORT_LACP_STATUS_MAP_BOND_SPEED,
+};
 
-} /* db_delete_lag_port */
+void
+db_clear_lag_partner_info_port(struct port_data *portp)
+{
+    const struct ovsrec_port *prow;
+    struct smap_node *node;
+    size_t i;
+
+    prow = portp->cfg;
+
+    /* set everything to empty; the keys lacpd writes may still be
+     * pending in this transaction, so delete those by name too. */
+    for (i = 0; i < ARRAY_SIZE(port_lacp_status_keys); i++) {
+        ovsrec_port_update_lacp_status_delkey(prow, port_lacp_status_keys[i]);
+    }
+    SMAP_FOR_EACH(node, &prow->lacp_status) {
+        ovsrec_port_update_lacp_status_delkey(prow, node->key);
+    }
+
+    free(portp->speed_str);
+    portp->speed_str = NULL;
+    portp->current_status = STATUS_UNINITIALIZED;
+}
+
+static bool
+delta_partner_clear(const struct lacp_delta *delta)
+{
+    struct port_data *portp;
+
+    /* get port */
+    portp = find_port_data_by_lag_id(delta->lag_id);
+
+    if (portp == NULL) {
+        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", delta->lag_id);
+        return false;
+    }
+
+    db_clear_lag_partner_info_port(portp);
+
+    return true;
+} /* delta_partner_clear */
+
+static bool
+delta_partner_update(const struct lacp_delta *delta)
+{
+    const struct ovsrec_port *prow;
+    struct port_data *portp;
+    bool changes = false;
+    char *speed_str;
+
+    /* get port */
+    portp = find_port_data_by_lag_id(delta->lag_id);
+
+    if (portp == NULL) {
+        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", delta->lag_id);
+        return false;
+    }
+
+    prow = portp->cfg;
+
+    /* update speed */
+    asprintf(&speed_str, "%d", portp->lag_member_speed);
+    if (portp->speed_str == NULL || strcmp(speed_str, portp->speed_str) != 0) {
+        free(portp->speed_str);
+        portp->speed_str = speed_str;
+        ovsrec_port_update_lacp_status_setkey(prow,
+                                              PORT_LACP_STATUS_MAP_BOND_SPEED,
+                                              speed_str);
+        changes = true;
+    } else {
+        free(speed_str);
+    }
+
+    return changes;
+} /* delta_partner_update */
+
+/* The kernel link watch took the port down ahead of OVSDB, and the
+ * kernel link runs again.  If OVSDB never saw the link go down, nothing
+ * else would bring the port back up, so resend the link state. */
+static bool
+delta_link_resync(const struct lacp_delta *delta)
+{
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
+
+    if (idp && idp->lag_eligible && idp->port_datap &&
+        LACP_ENABLED_ON_PORT(idp->port_datap->lacp_mode) &&
+        idp->link_state == INTERFACE_LINK_STATE_UP) {
+        send_link_state_change_msg(idp);
+    }
+
+    return false;
+} /* delta_link_resync */
+
+/* The old shard of a moving interface is done with it.  Every move has
+ * its own sequence number, so a stale answer is ignored. */
+static bool
+delta_shard_synced(const struct lacp_delta *delta)
+{
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
+
+    if (idp && idp->move_pending && idp->move_seq == delta->seq) {
+        iface_move_done(idp);
+    }
+
+    return false;
+} /* delta_shard_synced */
+
+/* Marks the rows 'delta' wrote for rewrite, after its transaction
+ * failed. */
+static void
+delta_rewrite(const struct lacp_delta *delta)
+{
+    struct iface_data *idp = find_iface_data_by_index(delta->port);
+    struct port_data *portp = find_port_data_by_lag_id(delta->lag_id);
+
+    if (idp) {
+        db_rewrite_interface(idp);
+    }
+    if (portp) {
+        db_rewrite_port(portp);
+    }
+} /* delta_rewrite */
+
+static bool
+delta_apply(const struct lacp_delta *delta)
+{
+    switch (delta->type) {
+    case LACP_DELTA_HW_ATTACH:          return delta_hw_attach(delta);
+    case LACP_DELTA_HW_DETACH:          return delta_hw_detach(delta);
+    case LACP_DELTA_HW_EGRESS_ENABLE:   return delta_hw_egress_enable(delta);
+    case LACP_DELTA_LAG_PORT_ADD:       return delta_lag_port_add(delta);
+    case LACP_DELTA_LAG_PORT_DELETE:    return delta_lag_port_delete(delta);
+    case LACP_DELTA_PARTNER_UPDATE:     return delta_partner_update(delta);
+    case LACP_DELTA_PARTNER_CLEAR:      return delta_partner_clear(delta);
+    case LACP_DELTA_LINK_RESYNC:        return delta_link_resync(delta);
+    case LACP_DELTA_SHARD_SYNCED:       return delta_shard_synced(delta);
+    }
+
+    return false;
+} /* delta_apply */
+
+/* Applies the deltas the protocol thread has queued so far, in order,
+ * in one transaction.  Called from the OVS thread with OVSDB_LOCK held. */
+static void
+delta_channel_run(void)
+{
+    struct lacp_delta *batch;
+    size_t allocated;
+    size_t n, i;
+    struct ovsdb_idl_txn *txn;
+    long long start;
+    bool changes = false;
+
+    delta_seqno = seq_read(delta_seq);
+
+    /* Swap the queues, so the protocol thread can carry on. */
+    pthread_mutex_lock(&delta_mutex);
+    n = delta_n_pending;
+    batch = delta_pending;
+    allocated = delta_pending_allocated;
+    delta_pending = delta_batch;
+    delta_pending_allocated = delta_batch_allocated;
+    delta_n_pending = 0;
+    pthread_mutex_unlock(&delta_mutex);
+
+    delta_batch = batch;
+    delta_batch_allocated = allocated;
+
+    if (n == 0) {
+        return;
+    }
+
+    start = time_msec();
+
+    status_txn_complete();
+    txn = ovsdb_idl_txn_create(idl);
+
+    for (i = 0; i < n; i++) {
+        if (delta_apply(&delta_batch[i])) {
+            changes = true;
+        }
+    }
+
+    if (changes) {
+        enum ovsdb_idl_txn_status status = ovsdb_idl_txn_commit_block(txn);
+
+        if (txn_failed(status)) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+            VLOG_WARN_RL(&rl, "LACP state update failed: %s",
+                         ovsdb_idl_txn_status_to_string(status));
+            delta_n_failed++;
+            for (i = 0; i < n; i++) {
+                delta_rewrite(&delta_batch[i]);
+            }
+        }
+    } else {
+        ovsdb_idl_txn_abort(txn);
+    }
+    ovsdb_idl_txn_destroy(txn);
+
+    delta_n_applied += n;
+    delta_n_batches++;
+    if (n > delta_max_batch) {
+        delta_max_batch = n;
+    }
+    delta_last_apply = time_msec() - start;
+    if (delta_last_apply > delta_max_apply) {
+        delta_max_apply = delta_last_apply;
+    }
+} /* delta_channel_run */
+
+static void
+delta_channel_wait(void)
+{
+    seq_wait(delta_seq, delta_seqno);
+} /* delta_channel_wait */
+
+/**
+ * @details
+ * Asks the OVS thread to turn off TX in h/w for a member whose link went
+ * down, ahead of everything else it has to do.  Called from the
+ * lacpdu_rx_thread when the kernel reports the link stopped running.
+ */
+void
+lacpd_fast_tx_disable(const char *name, int port)
+{
+    struct fast_tx_request *req;
+
+    pthread_mutex_lock(&fast_tx_mutex);
+
+    if (fast_tx_n_pending == fast_tx_pending_allocated) {
+        fast_tx_pending_allocated = (fast_tx_pending_allocated
+                                     ? 2 * fast_tx_pending_allocated : 16);
+        fast_tx_pending = xrealloc(fast_tx_pending,
+                                   fast_tx_pending_allocated
+                                   * sizeof *fast_tx_pending);
+    }
+    req = &fast_tx_pending[fast_tx_n_pending++];
+    ovs_strlcpy(req->name, name, sizeof req->name);
+    req->port = port;
+    req->detected = time_usec();
+
+    if (fast_tx_n_pending == 1) {
+        seq_change(fast_tx_seq);
+    }
+
+    pthread_mutex_unlock(&fast_tx_mutex);
+} /* lacpd_fast_tx_disable */
+
+/* Writes tx_enabled=false for the member into *txnp, creating the
+ * transaction on first use.  Returns true if the member was still
+ * transmitting. */
+static bool
+fast_tx_disable_member(struct iface_data *idp, struct ovsdb_idl_txn **txnp)
+{
+    if (idp->lacp_state != LACP_STATE_ENABLED ||
+        !idp->hw_bond_tx_enabled ||
+        ovsrec_interface_is_deleted(idp->cfg)) {
+        return false;
+    }
+
+    if (*txnp == NULL) {
+        status_txn_complete();
+        *txnp = ovsdb_idl_txn_create(idl);
+    }
+
+    /* Only tx_enabled, bond_status is left to the state machines. */
+    update_interface_hw_bond_config_map_entry(
+        idp,
+        INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
+        INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+
+    VLOG_DBG("Fast TX disable of %s", idp->name);
+    return true;
+} /* fast_tx_disable_member */
+
+/**
+ * @details
+ * Turns off TX in h/w for the LACP members that lost their link, either
+ * as reported by the kernel link watch or as seen in the link_state
+ * updates from the last IDL run, in one transaction that carries nothing
+ * else.  Must run before lacpd_reconfigure() clears the IDL change
+ * tracking.  Called from the OVS thread with OVSDB_LOCK held.
+ */
+static void
+fast_tx_disable_run(void)
+{
+    const struct ovsrec_interface *ifrow;
+    struct ovsdb_idl_txn *txn = NULL;
+    struct fast_tx_request *batch;
+    enum ovsdb_idl_txn_status status;
+    long long now = time_usec();
+    long long first = now;
+    size_t allocated;
+    size_t n, i;
+    int n_ports = 0;
+
+    fast_tx_seqno = seq_read(fast_tx_seq);
+
+    /* Swap the request arrays, so the link watch can carry on. */
+    pthread_mutex_lock(&fast_tx_mutex);
+    batch = fast_tx_pending;
+    allocated = fast_tx_pending_allocated;
+    n = fast_tx_n_pending;
+    fast_tx_pending = fast_tx_batch;
+    fast_tx_pending_allocated = fast_tx_batch_allocated;
+    fast_tx_n_pending = 0;
+    pthread_mutex_unlock(&fast_tx_mutex);
+
+    fast_tx_batch = batch;
+    fast_tx_batch_allocated = allocated;
+
+    for (i = 0; i < n; i++) {
+        struct iface_data *idp = find_iface_data_by_index(batch[i].port);
+
+        /* The index may have been reused since the request was queued. */
+        if (idp && !strcmp(idp->name, batch[i].name) &&
+            fast_tx_disable_member(idp, &txn)) {
+            if (batch[i].detected < first) {
+                first = batch[i].detected;
+            }
+            n_ports++;
+        }
+    }
+
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        struct iface_data *idp;
+
+        if (ovsrec_interface_is_deleted(ifrow) ||
+            ovsrec_interface_is_new(ifrow) ||
+            !ovsrec_interface_is_updated(ifrow,
+                                         OVSREC_INTERFACE_COL_LINK_STATE) ||
+            (ifrow->link_state &&
+             !strcmp(ifrow->link_state, OVSREC_INTERFACE_LINK_STATE_UP))) {
+            continue;
+        }
+
+        idp = shash_find_data(&all_interfaces, ifrow->name);
+        if (idp && fast_tx_disable_member(idp, &txn)) {
+            n_ports++;
+        }
+    }
+
+    if (txn == NULL) {
+        return;
+    }
+
+    status = ovsdb_idl_txn_commit_block(txn);
+    ovsdb_idl_txn_destroy(txn);
+
+    if (txn_failed(status)) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        struct shash_node *node;
+
+        VLOG_WARN_RL(&rl, "Fast TX disable failed: %s",
+                     ovsdb_idl_txn_status_to_string(status));
+
+        /* hw_bond_tx_enabled already reads false for these, so
+         * fast_tx_disable_member() can't tell them apart any more. */
+        SHASH_FOR_EACH(node, &all_interfaces) {
+            struct iface_data *idp = node->data;
+
+            if (idp->lacp_state == LACP_STATE_ENABLED &&
+                !idp->hw_bond_tx_enabled) {
+                db_rewrite_interface(idp);
+            }
+        }
+    }
+
+    fast_tx_n_commits++;
+    fast_tx_n_ports += n_ports;
+    fast_tx_last_latency = time_usec() - first;
+    if (fast_tx_last_latency > fast_tx_max_latency) {
+        fast_tx_max_latency = fast_tx_last_latency;
+    }
+} /* fast_tx_disable_run */
+
+static void
+fast_tx_disable_wait(void)
+{
+    seq_wait(fast_tx_seq, fast_tx_seqno);
+} /* fast_tx_disable_wait */
+
+/* Marks an interface for rewrite of its hw_bond_config and bond_status,
+ * after a transaction that wrote them failed. */
+static void
+db_rewrite_interface(struct iface_data *idp)
+{
+    if (!db_rewrite_pending) {
+        db_rewrite_pending = true;
+        db_rewrite_next = time_msec();
+    }
+    idp->rewrite = true;
+
+    if (idp->port_datap) {
+        db_rewrite_port(idp->port_datap);
+    }
+} /* db_rewrite_interface */
+
+/* Marks a port for rewrite of its lacp_status and bond_status, after a
+ * transaction that wrote them failed. */
+static void
+db_rewrite_port(struct port_data *portp)
+{
+    if (!db_rewrite_pending) {
+        db_rewrite_pending = true;
+        db_rewrite_next = time_msec();
+    }
+    portp->rewrite = true;
+
+    forget_port_status(portp);
+} /* db_rewrite_port */
+
+/* Writes again what lacpd owns in the rows marked for rewrite, in one
+ * transaction, retrying every DB_REWRITE_INTERVAL ms until it goes
+ * through.  Called from the OVS thread with OVSDB_LOCK held. */
+static void
+db_rewrite_run(void)
+{
+    struct ovsdb_idl_txn *txn;
+    enum ovsdb_idl_txn_status status;
+    struct shash_node *node;
+
+    if (!db_rewrite_pending || time_msec() < db_rewrite_next) {
+        return;
+    }
+
+    status_txn_complete();
+    txn = ovsdb_idl_txn_create(idl);
+
+    SHASH_FOR_EACH(node, &all_interfaces) {
+        struct iface_data *idp = node->data;
+
+        if (!idp->rewrite || idp->lacp_state != LACP_STATE_ENABLED) {
+            continue;
+        }
+        update_interface_hw_bond_config_map_entry(
+            idp, INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
+            (idp->hw_bond_rx_enabled ?
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
+        update_interface_hw_bond_config_map_entry(
+            idp, INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
+            (idp->hw_bond_tx_enabled ?
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
+             INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
+        if (idp->port_datap) {
+            update_interface_bond_status_map_entry(idp);
+        }
+    }
+
+    SHASH_FOR_EACH(node, &all_ports) {
+        struct port_data *portp = node->data;
+
+        if (portp->rewrite) {
+            db_set_port_status(portp);
+        }
+    }
+
+    status = ovsdb_idl_txn_commit_block(txn);
+    ovsdb_idl_txn_destroy(txn);
+
+    if (txn_failed(status)) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_WARN_RL(&rl, "LACP rewrite failed: %s",
+                     ovsdb_idl_txn_status_to_string(status));
+
+        /* db_set_port_status() filled the caches in again. */
+        SHASH_FOR_EACH(node, &all_ports) {
+            struct port_data *portp = node->data;
+
+            if (portp->rewrite) {
+                db_rewrite_port(portp);
+            }
+        }
+        db_rewrite_next = time_msec() + DB_REWRITE_INTERVAL;
+        return;
+    }
+
+    SHASH_FOR_EACH(node, &all_interfaces) {
+        ((struct iface_data *)node->data)->rewrite = false;
+    }
+    SHASH_FOR_EACH(node, &all_ports) {
+        ((struct port_data *)node->data)->rewrite = false;
+    }
+    db_rewrite_pending = false;
+} /* db_rewrite_run */
+
+/**********************************************************************/
+/*                               DEBUG                                */
+/**********************************************************************/
+static char *
+lacp_mode_str(enum ovsrec_port_lacp_e mode)
+{
+    switch (mode) {
+    case PORT_LACP_OFF:     return OVSREC_PORT_LACP_OFF;
+    case PORT_LACP_ACTIVE:  return OVSREC_PORT_LACP_ACTIVE;
+    case PORT_LACP_PASSIVE: return OVSREC_PORT_LACP_PASSIVE;
+    default:                return "???";
+    }
+} /* lacp_mode_str */
+
+/**
+ * @details
+ * Copies the names of the interfaces in ifs that lacpd knows about.
+ */
+static void
+view_copy_members(struct svec *members, const struct shash *ifs)
+{
+    struct shash_node *node;
+
+    svec_init(members);
+    SHASH_FOR_EACH(node, ifs) {
+        if (shash_find_data(&all_interfaces, node->name)) {
+            svec_add(members, node->name);
+        }
+    }
+} /* view_copy_members */
 
-void
-db_clear_lag_partner_info_port(struct port_data *portp)
+/**
+ * @details
+ * Builds a copy of the interface and port caches for the appctl thread.
+ * Must be called from the OVS thread.
+ */
+static struct lacpd_view *
+view_build(void)
 {
-    const struct ovsrec_port *prow;
-    struct smap smap;
+    struct lacpd_view *v;
+    struct shash_node *sh_node;
+    int lag_id;
 
-    prow = portp->cfg;
+    v = xzalloc(sizeof *v);
+    v->ref_cnt = 1;
+    shash_init(&v->interfaces);
+    shash_init(&v->ports);
 
-    smap_init(&smap);
+    SHASH_FOR_EACH(sh_node, &all_interfaces) {
+        struct iface_data *idp = sh_node->data;
+        struct view_iface *vi = xzalloc(sizeof *vi);
+
+        vi->name = xstrdup(idp->name);
+        vi->index = idp->index;
+        vi->link_state = idp->link_state;
+        vi->link_speed = idp->link_speed;
+        vi->duplex = idp->duplex;
+        vi->lag_name = idp->port_datap ? xstrdup(idp->port_datap->name) : NULL;
+        vi->lag_eligible = idp->lag_eligible;
+        shash_add(&v->interfaces, vi->name, vi);
+    }
 
-    /* set everything to empty */
-    ovsrec_port_set_lacp_status(prow, &smap);
+    SHASH_FOR_EACH(sh_node, &all_ports) {
+        struct port_data *portp = sh_node->data;
+        struct view_port *vp = xzalloc(sizeof *vp);
+
+        vp->name = xstrdup(portp->name);
+        vp->lag_id = portp->lag_id;
+        vp->lacp_mode = portp->lacp_mode;
+        vp->lag_member_speed = portp->lag_member_speed;
+        vp->n_participants = (int)shash_count(&portp->participant_ifs);
+        view_copy_members(&vp->cfg_members, &portp->cfg_member_ifs);
+        view_copy_members(&vp->eligible_members, &portp->eligible_member_ifs);
+        view_copy_members(&vp->participant_members, &portp->participant_ifs);
+        shash_add(&v->ports, vp->name, vp);
+    }
 
-    smap_destroy(&smap);
+    if (lag_id_port_table) {
+        v->lag_names = xzalloc((max_lag_id + 1) * sizeof *v->lag_names);
+        for (lag_id = min_lag_id; lag_id <= max_lag_id; lag_id++) {
+            if (lag_id_port_table[lag_id]) {
+                v->lag_names[lag_id] =
+                    xstrdup(lag_id_port_table[lag_id]->name);
+            }
+        }
+    }
 
-    free(portp->speed_str);
-    portp->speed_str = NULL;
-    portp->current_status = STATUS_UNINITIALIZED;
-}
+    return v;
+} /* view_build */
 
-void
-db_clear_lag_partner_info(uint16_t lag_id)
+static void
+view_free(struct lacpd_view *v)
 {
-    struct port_data *portp;
-    struct ovsdb_idl_txn *txn = NULL;
-
-    /* acquire lock */
-    OVSDB_LOCK;
-
-    /* get port */
-    portp = find_port_data_by_lag_id(lag_id);
+    struct shash_node *sh_node;
+    int lag_id;
 
-    if (portp == NULL) {
-        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+    SHASH_FOR_EACH(sh_node, &v->interfaces) {
+        struct view_iface *vi = sh_node->data;
+        free(vi->name);
+        free(vi->lag_name);
+        free(vi);
     }
+    shash_destroy(&v->interfaces);
+
+    SHASH_FOR_EACH(sh_node, &v->ports) {
+        struct view_port *vp = sh_node->data;
+        free(vp->name);
+        svec_destroy(&vp->cfg_members);
+        svec_destroy(&vp->eligible_members);
+        svec_destroy(&vp->participant_members);
+        free(vp);
+    }
+    shash_destroy(&v->ports);
 
-    txn = ovsdb_idl_txn_create(idl);
+    if (v->lag_names) {
+        for (lag_id = min_lag_id; lag_id <= max_lag_id; lag_id++) {
+            free(v->lag_names[lag_id]);
+        }
+        free(v->lag_names);
+    }
+    free(v);
+} /* view_free */
 
-    db_clear_lag_partner_info_port(portp);
+/**
+ * @details
+ * Returns a reference to the current view, or NULL if the OVS thread
+ * hasn't published one yet.  Release it with view_put().
+ */
+static struct lacpd_view *
+view_get(void)
+{
+    struct lacpd_view *v;
 
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
+    pthread_mutex_lock(&view_mutex);
+    v = view;
+    if (v) {
+        v->ref_cnt++;
+    }
+    pthread_mutex_unlock(&view_mutex);
 
-end:
-    OVSDB_UNLOCK;
-} /* db_clear_lag_partner_info */
+    return v;
+} /* view_get */
 
-void
-db_update_lag_partner_info(uint16_t lag_id)
+static void
+view_put(struct lacpd_view *v)
 {
-    const struct ovsrec_port *prow;
-    struct port_data *portp;
-    struct smap smap;
-    struct ovsdb_idl_txn *txn = NULL;
-    bool changes = false;
-    char *speed_str;
+    int ref_cnt;
 
-    /* acquire lock */
-    OVSDB_LOCK;
+    if (v == NULL) {
+        return;
+    }
 
-    /* get port */
-    portp = find_port_data_by_lag_id(lag_id);
+    pthread_mutex_lock(&view_mutex);
+    ref_cnt = --v->ref_cnt;
+    pthread_mutex_unlock(&view_mutex);
 
-    if (portp == NULL) {
-        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+    if (ref_cnt == 0) {
+        view_free(v);
     }
+} /* view_put */
 
-    prow = portp->cfg;
-
-    smap_clone(&smap, &prow->lacp_status);
+static void
+view_get_stats(struct view_stats *stats)
+{
+    pthread_mutex_lock(&view_mutex);
+    *stats = view_stats;
+    pthread_mutex_unlock(&view_mutex);
+} /* view_get_stats */
 
-    txn = ovsdb_idl_txn_create(idl);
+/**
+ * @details
+ * Publishes a new view if the caches changed since the last one, and
+ * the current status writer, delta channel and fast TX disable
+ * metrics.  Called from the OVS thread at the end of each pass.
+ */
+static void
+view_run(void)
+{
+    struct lacpd_view *new_view = NULL;
+    struct lacpd_view *old_view = NULL;
 
-    /* update speed */
-    asprintf(&speed_str, "%d", portp->lag_member_speed);
-    if (portp->speed_str == NULL || strcmp(speed_str, portp->speed_str) != 0) {
-        free(portp->speed_str);
-        portp->speed_str = speed_str;
-        smap_replace(&smap, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
-        changes = true;
-    } else {
-        free(speed_str);
+    /* Build outside the lock, appctl readers only wait for the swap. */
+    if (view_dirty) {
+        new_view = view_build();
+        view_dirty = false;
     }
 
-    if (changes) {
-        ovsrec_port_set_lacp_status(prow, &smap);
-        ovsdb_idl_txn_commit_block(txn);
-    } else {
-        ovsdb_idl_txn_abort(txn);
+    pthread_mutex_lock(&view_mutex);
+    if (new_view) {
+        old_view = view;
+        view = new_view;
     }
+    view_stats.status_interval = status_interval;
+    view_stats.status_n_commits = status_n_commits;
+    view_stats.status_n_failed = status_n_failed;
+    view_stats.status_n_updates = status_n_updates;
+    view_stats.status_last_batch = status_last_batch;
+    view_stats.status_max_batch = status_max_batch;
+    view_stats.status_last_latency = status_last_latency;
+    view_stats.status_max_latency = status_max_latency;
+    view_stats.status_total_latency = status_total_latency;
+    view_stats.delta_n_applied = delta_n_applied;
+    view_stats.delta_n_batches = delta_n_batches;
+    view_stats.delta_n_failed = delta_n_failed;
+    view_stats.delta_max_batch = delta_max_batch;
+    view_stats.delta_last_apply = delta_last_apply;
+    view_stats.delta_max_apply = delta_max_apply;
+    view_stats.fast_tx_n_commits = fast_tx_n_commits;
+    view_stats.fast_tx_n_ports = fast_tx_n_ports;
+    view_stats.fast_tx_last_latency = fast_tx_last_latency;
+    view_stats.fast_tx_max_latency = fast_tx_max_latency;
+    pthread_mutex_unlock(&view_mutex);
+
+    view_put(old_view);
+} /* view_run */
 
-    ovsdb_idl_txn_destroy(txn);
-
-    smap_destroy(&smap);
-
-end:
-    OVSDB_UNLOCK;
+static void
+view_exit(void)
+{
+    struct lacpd_view *old_view;
 
-} /* db_update_lag_partner_info */
+    pthread_mutex_lock(&view_mutex);
+    old_view = view;
+    view = NULL;
+    pthread_mutex_unlock(&view_mutex);
 
-/**********************************************************************/
-/*                               DEBUG                                */
-/**********************************************************************/
-static char *
-lacp_mode_str(enum ovsrec_port_lacp_e mode)
-{
-    switch (mode) {
-    case PORT_LACP_OFF:     return OVSREC_PORT_LACP_OFF;
-    case PORT_LACP_ACTIVE:  return OVSREC_PORT_LACP_ACTIVE;
-    case PORT_LACP_PASSIVE: return OVSREC_PORT_LACP_PASSIVE;
-    default:                return "???";
-    }
-} /* lacp_mode_str */
+    view_put(old_view);
+} /* view_exit */
 
 static void
-lacpd_interface_dump(struct ds *ds, struct iface_data *idp)
+lacpd_interface_dump(struct ds *ds, const struct view_iface *vi)
 {
-    ds_put_format(ds, "Interface %s:\n", idp->name);
+    ds_put_format(ds, "Interface %s:\n", vi->name);
+    ds_put_format(ds, "    index                : %d\n", vi->index);
     ds_put_format(ds, "    link_state           : %s\n",
-                  idp->link_state == INTERFACE_LINK_STATE_UP
+                  vi->link_state == INTERFACE_LINK_STATE_UP
                   ? OVSREC_INTERFACE_LINK_STATE_UP :
                   OVSREC_INTERFACE_LINK_STATE_DOWN);
     ds_put_format(ds, "    link_speed           : %d Mbps\n",
-                  idp->link_speed);
+                  vi->link_speed);
     ds_put_format(ds, "    duplex               : %s\n",
-                  idp->duplex == INTERFACE_DUPLEX_FULL
+                  vi->duplex == INTERFACE_DUPLEX_FULL
                   ? OVSREC_INTERFACE_DUPLEX_FULL :
                   OVSREC_INTERFACE_DUPLEX_HALF);
-    if (idp->port_datap) {
+    if (vi->lag_name) {
         ds_put_format(ds, "    configured LAG       : %s\n",
-                      idp->port_datap->name);
+                      vi->lag_name);
         ds_put_format(ds, "    LAG eligible         : %s\n",
-                      idp->lag_eligible ? "true" : "false");
+                      vi->lag_eligible ? "true" : "false");
     }
 } /* lacpd_interface_dump */
 
 static void
-lacpd_interfaces_dump(struct ds *ds, int argc, const char *argv[])
+lacpd_interfaces_dump(struct ds *ds, const struct lacpd_view *v,
+                      int argc, const char *argv[])
 {
     struct shash_node *sh_node;
-    struct iface_data *idp = NULL;
+    struct view_iface *vi = NULL;
 
     if (argc > 2) { /* an interface is specified in argv */
-        struct iface_data *idp =
-            shash_find_data(&all_interfaces, argv[2]);
-        if (idp){
-            lacpd_interface_dump(ds, idp);
+        vi = shash_find_data(&v->interfaces, argv[2]);
+        if (vi){
+            lacpd_interface_dump(ds, vi);
         }
     } else { /* dump all interfaces */
         ds_put_cstr(ds, "================ Interfaces ================\n");
 
-        SHASH_FOR_EACH(sh_node, &all_interfaces) {
-            idp = sh_node->data;
-            if (idp){
-                lacpd_interface_dump(ds, idp);
+        SHASH_FOR_EACH(sh_node, &v->interfaces) {
+            vi = sh_node->data;
+            if (vi){
+                lacpd_interface_dump(ds, vi);
             }
         }
     }
@@ -3226,77 +4857,311 @@ lacpd_interfaces_dump(struct ds *ds, int argc, const char *argv[])
 /**
  * @details
  * Dumps the configured, eligible and participant interfaces of one lag
- * specified in portp parameter.
+ * specified in vp parameter.
  */
 static void
-lacpd_lag_member_interfaces_dump(struct ds *ds, struct port_data *portp)
+lacpd_lag_member_interfaces_dump(struct ds *ds, const struct view_port *vp)
 {
-    struct shash_node *node;
+    const char *name;
+    size_t i;
 
     ds_put_format(ds, "    configured_members   :");
-    SHASH_FOR_EACH(node, &portp->cfg_member_ifs) {
-        struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            ds_put_format(ds, " %s", idp->name);
-        }
+    SVEC_FOR_EACH(i, name, &vp->cfg_members) {
+        ds_put_format(ds, " %s", name);
     }
     ds_put_format(ds, "\n");
 
     ds_put_format(ds, "    eligible_members     :");
-    SHASH_FOR_EACH(node, &portp->eligible_member_ifs) {
-        struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            ds_put_format(ds, " %s", idp->name);
-        }
+    SVEC_FOR_EACH(i, name, &vp->eligible_members) {
+        ds_put_format(ds, " %s", name);
     }
     ds_put_format(ds, "\n");
 
     ds_put_format(ds, "    participant_members  :");
-    SHASH_FOR_EACH(node, &portp->participant_ifs) {
-        struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            ds_put_format(ds, " %s", idp->name);
-        }
+    SVEC_FOR_EACH(i, name, &vp->participant_members) {
+        ds_put_format(ds, " %s", name);
     }
     ds_put_format(ds, "\n");
 } /* lacpd_lag_member_interfaces_dump */
 
 static void
-lacpd_port_dump(struct ds *ds, struct port_data *portp)
+lacpd_port_dump(struct ds *ds, const struct view_port *vp)
 {
-    ds_put_format(ds, "Port %s:\n", portp->name);
+    ds_put_format(ds, "Port %s:\n", vp->name);
     ds_put_format(ds, "    lacp                 : %s\n",
-                  lacp_mode_str(portp->lacp_mode));
+                  lacp_mode_str(vp->lacp_mode));
+    ds_put_format(ds, "    lag_id               : %d\n",
+                  vp->lag_id);
     ds_put_format(ds, "    lag_member_speed     : %d\n",
-                  portp->lag_member_speed);
-    lacpd_lag_member_interfaces_dump(ds, portp);
+                  vp->lag_member_speed);
+    lacpd_lag_member_interfaces_dump(ds, vp);
     ds_put_format(ds, "    interface_count      : %d\n",
-                  (int)shash_count(&portp->participant_ifs));
+                  vp->n_participants);
 } /* lacpd_port_dump */
 
 static void
-lacpd_ports_dump(struct ds *ds, int argc, const char *argv[])
+lacpd_ports_dump(struct ds *ds, const struct lacpd_view *v,
+                 int argc, const char *argv[])
 {
     struct shash_node *sh_node;
-    struct port_data *portp = NULL;
+    struct view_port *vp = NULL;
 
     if (argc > 2) { /* a port is specified in argv */
-        portp = shash_find_data(&all_ports, argv[2]);
-        if (portp){
-            lacpd_port_dump(ds, portp);
+        vp = shash_find_data(&v->ports, argv[2]);
+        if (vp){
+            lacpd_port_dump(ds, vp);
         }
     } else { /* dump all ports */
         ds_put_cstr(ds, "================ Ports ================\n");
 
-        SHASH_FOR_EACH(sh_node, &all_ports) {
-            portp = sh_node->data;
-            if (portp){
-                lacpd_port_dump(ds, portp);
+        SHASH_FOR_EACH(sh_node, &v->ports) {
+            vp = sh_node->data;
+            if (vp){
+                lacpd_port_dump(ds, vp);
             }
         }
     }
 } /* lacpd_ports_dump */
 
+/**
+ * @details
+ * Dumps the LAG ID to port mapping maintained by the LAG ID allocator,
+ * or the entry of a single LAG ID if one is specified in argv.
+ */
+static void
+lacpd_lag_ids_dump(struct ds *ds, const struct lacpd_view *v,
+                   int argc, const char *argv[])
+{
+    int lag_id;
+
+    if (v->lag_names == NULL) {
+        return;
+    }
+
+    if (argc > 2) { /* a LAG ID is specified in argv */
+        lag_id = atoi(argv[2]);
+        if (VALID_LAG_ID(lag_id) && v->lag_names[lag_id]) {
+            ds_put_format(ds, "LAG ID %d: %s\n", lag_id, v->lag_names[lag_id]);
+        }
+    } else { /* dump all allocated LAG IDs */
+        ds_put_cstr(ds, "================ LAG IDs ================\n");
+
+        for (lag_id = min_lag_id; lag_id <= max_lag_id; lag_id++) {
+            if (v->lag_names[lag_id]) {
+                ds_put_format(ds, "LAG ID %d: %s\n",
+                              lag_id, v->lag_names[lag_id]);
+            }
+        }
+    }
+} /* lacpd_lag_ids_dump */
+
+/**
+ * @details
+ * Dumps the usage of each protocol shard's LAG pool.  The shards peak
+ * at different times, so their high water marks are not added up.
+ */
+static void
+lacpd_lag_pool_dump(struct ds *ds)
+{
+    int size, in_use, high_water;
+    int shard;
+
+    ds_put_cstr(ds, "================ LAG pool ================\n");
+    for (shard = 0; shard < ml_n_shards; shard++) {
+        LAG_pool_stats(shard, &size, &in_use, &high_water);
+
+        ds_put_format(ds, "    shard %-2d size        : %d\n", shard, size);
+        ds_put_format(ds, "    shard %-2d in_use      : %d\n", shard, in_use);
+        ds_put_format(ds, "    shard %-2d high_water  : %d\n",
+                      shard, high_water);
+    }
+} /* lacpd_lag_pool_dump */
+
+/**
+ * @details
+ * Dumps the number of events each protocol shard has processed, the h/w
+ * and lacp_status updates per LACPDU before and after coalescing, and
+ * how long its LAGs took to get all members distributing.
+ */
+static void
+lacpd_shards_dump(struct ds *ds)
+{
+    ml_effects_stats_t effects;
+    int shard;
+
+    ds_put_cstr(ds, "================ Protocol shards ================\n");
+    ds_put_format(ds, "    shards               : %d\n", ml_n_shards);
+    for (shard = 0; shard < ml_n_shards; shard++) {
+        ml_shard_effects_stats(shard, &effects);
+
+        ds_put_format(ds, "    shard %-2d events      : %llu\n",
+                      shard, ml_shard_n_events(shard));
+        ds_put_format(ds, "    shard %-2d lacpdus     : %llu\n",
+                      shard, effects.n_pdus);
+        ds_put_format(ds, "    shard %-2d updates/pdu : %.2f requested, "
+                      "%.2f applied\n", shard,
+                      effects.n_pdus ?
+                      (double)effects.n_requested / effects.n_pdus : 0.0,
+                      effects.n_pdus ?
+                      (double)effects.n_applied / effects.n_pdus : 0.0);
+        ds_put_format(ds, "    shard %-2d lag_bringups: %llu, last %lld ms, "
+                      "max %lld ms\n", shard, effects.n_bringups,
+                      effects.last_bringup, effects.max_bringup);
+    }
+} /* lacpd_shards_dump */
+
+/**
+ * @details
+ * Dumps each protocol shard's event handling time histogram and its
+ * slowest events.
+ */
+static void
+lacpd_stalls_dump(struct ds *ds)
+{
+    ml_stall_stats_t stats;
+    char label[32];
+    int shard, bucket, i;
+
+    ds_put_cstr(ds, "================ Protocol event times ================\n");
+    ds_put_format(ds, "    stall_threshold      : %d ms\n",
+                  ml_stall_threshold());
+    for (shard = 0; shard < ml_n_shards; shard++) {
+        ml_shard_stall_stats(shard, &stats);
+
+        ds_put_format(ds, "Shard %d:\n", shard);
+        for (bucket = 0; bucket < ML_STALL_BUCKETS; bucket++) {
+            if (stats.hist[bucket] == 0) {
+                continue;
+            }
+            if (bucket == 0) {
+                snprintf(label, sizeof label, "< 1 us");
+            } else if (bucket == ML_STALL_BUCKETS - 1) {
+                snprintf(label, sizeof label, ">= %lld us",
+                         1LL << (bucket - 1));
+            } else {
+                snprintf(label, sizeof label, "%lld-%lld us",
+                         1LL << (bucket - 1), (1LL << bucket) - 1);
+            }
+            ds_put_format(ds, "    %-21s: %llu\n", label, stats.hist[bucket]);
+        }
+
+        for (i = 0; i < stats.n_worst; i++) {
+            const ml_stall_t *stall = &stats.worst[i];
+
+            ds_put_format(ds, "    slowest %-13d: %lld us %s",
+                          i + 1, stall->duration,
+                          ml_event_name(stall->peer, stall->msgnum));
+            if (stall->port >= 0) {
+                ds_put_format(ds, " port %d", stall->port);
+            }
+            if (stall->lag_id >= 0) {
+                ds_put_format(ds, " lag_id %d", stall->lag_id);
+            }
+            ds_put_strftime_msec(ds, " at %Y-%m-%d %H:%M:%S.###",
+                                 stall->when, false);
+            ds_put_cstr(ds, "\n");
+        }
+    }
+} /* lacpd_stalls_dump */
+
+/**
+ * @details
+ * Dumps the kernel link state watch counters.
+ */
+static void
+lacpd_link_watch_dump(struct ds *ds)
+{
+    ml_link_watch_stats_t stats;
+
+    ml_link_watch_get_stats(&stats);
+
+    ds_put_cstr(ds, "================ Kernel link watch ================\n");
+    ds_put_format(ds, "    enabled              : %s\n",
+                  stats.enabled ? "true" : "false");
+    ds_put_format(ds, "    interfaces           : %d\n", stats.n_watched);
+    ds_put_format(ds, "    link_messages        : %llu\n", stats.n_events);
+    ds_put_format(ds, "    fast_link_downs      : %llu\n", stats.n_fast_down);
+    ds_put_format(ds, "    resyncs              : %llu\n", stats.n_resync);
+} /* lacpd_link_watch_dump */
+
+/**
+ * @details
+ * Dumps the LACP status writer's settings and metrics.
+ */
+static void
+lacpd_status_writer_dump(struct ds *ds, const struct view_stats *st)
+{
+    ds_put_cstr(ds, "================ Status writer ================\n");
+    ds_put_format(ds, "    interval             : %d ms\n",
+                  st->status_interval);
+    ds_put_format(ds, "    commits              : %llu\n",
+                  st->status_n_commits);
+    ds_put_format(ds, "    failed_commits       : %llu\n",
+                  st->status_n_failed);
+    ds_put_format(ds, "    interface_updates    : %llu\n",
+                  st->status_n_updates);
+    ds_put_format(ds, "    last_batch           : %d\n",
+                  st->status_last_batch);
+    ds_put_format(ds, "    max_batch            : %d\n",
+                  st->status_max_batch);
+    ds_put_format(ds, "    last_latency         : %lld ms\n",
+                  st->status_last_latency);
+    ds_put_format(ds, "    max_latency          : %lld ms\n",
+                  st->status_max_latency);
+    ds_put_format(ds, "    avg_latency          : %lld ms\n",
+                  st->status_n_commits ?
+                  st->status_total_latency / (long long)st->status_n_commits
+                  : 0);
+} /* lacpd_status_writer_dump */
+
+/**
+ * @details
+ * Dumps the metrics of the channel that carries state changes from the
+ * protocol thread to the OVS thread.
+ */
+static void
+lacpd_delta_channel_dump(struct ds *ds, const struct view_stats *st)
+{
+    size_t pending;
+
+    pthread_mutex_lock(&delta_mutex);
+    pending = delta_n_pending;
+    pthread_mutex_unlock(&delta_mutex);
+
+    ds_put_cstr(ds, "================ Delta channel ================\n");
+    ds_put_format(ds, "    pending              : %zu\n", pending);
+    ds_put_format(ds, "    applied              : %llu\n",
+                  st->delta_n_applied);
+    ds_put_format(ds, "    batches              : %llu\n",
+                  st->delta_n_batches);
+    ds_put_format(ds, "    failed               : %llu\n",
+                  st->delta_n_failed);
+    ds_put_format(ds, "    max_batch            : %zu\n",
+                  st->delta_max_batch);
+    ds_put_format(ds, "    last_apply           : %lld ms\n",
+                  st->delta_last_apply);
+    ds_put_format(ds, "    max_apply            : %lld ms\n",
+                  st->delta_max_apply);
+} /* lacpd_delta_channel_dump */
+
+/**
+ * @details
+ * Dumps the metrics of the fast TX disable on member link down.
+ */
+static void
+lacpd_fast_tx_dump(struct ds *ds, const struct view_stats *st)
+{
+    ds_put_cstr(ds, "================ Fast TX disable ================\n");
+    ds_put_format(ds, "    commits              : %llu\n",
+                  st->fast_tx_n_commits);
+    ds_put_format(ds, "    interfaces           : %llu\n",
+                  st->fast_tx_n_ports);
+    ds_put_format(ds, "    last_latency         : %lld us\n",
+                  st->fast_tx_last_latency);
+    ds_put_format(ds, "    max_latency          : %lld us\n",
+                  st->fast_tx_max_latency);
+} /* lacpd_fast_tx_dump */
+
 /**
  * @details
  * Dumps debug data for entire daemon or for individual component specified
@@ -3306,18 +5171,52 @@ void
 lacpd_debug_dump(struct ds *ds, int argc, const char *argv[])
 {
     const char *table_name = NULL;
+    struct lacpd_view *v;
+    struct view_stats st;
+
+    v = view_get();
+    if (v == NULL) {
+        return;
+    }
+    view_get_stats(&st);
 
     if (argc > 1) {
         table_name = argv[1];
         if (!strcmp(table_name, "interface")) {
-            lacpd_interfaces_dump(ds, argc, argv);
+            lacpd_interfaces_dump(ds, v, argc, argv);
         } else if (!strcmp(table_name, "port")) {
-            lacpd_ports_dump(ds, argc, argv);
+            lacpd_ports_dump(ds, v, argc, argv);
+        } else if (!strcmp(table_name, "lag_id")) {
+            lacpd_lag_ids_dump(ds, v, argc, argv);
+        } else if (!strcmp(table_name, "lag_pool")) {
+            lacpd_lag_pool_dump(ds);
+        } else if (!strcmp(table_name, "status_writer")) {
+            lacpd_status_writer_dump(ds, &st);
+        } else if (!strcmp(table_name, "delta")) {
+            lacpd_delta_channel_dump(ds, &st);
+        } else if (!strcmp(table_name, "shards")) {
+            lacpd_shards_dump(ds);
+        } else if (!strcmp(table_name, "stalls")) {
+            lacpd_stalls_dump(ds);
+        } else if (!strcmp(table_name, "link_watch")) {
+            lacpd_link_watch_dump(ds);
+        } else if (!strcmp(table_name, "fast_tx")) {
+            lacpd_fast_tx_dump(ds, &st);
         }
     } else {
-        lacpd_interfaces_dump(ds, 0, NULL);
-        lacpd_ports_dump(ds, 0, NULL);
+        lacpd_interfaces_dump(ds, v, 0, NULL);
+        lacpd_ports_dump(ds, v, 0, NULL);
+        lacpd_lag_ids_dump(ds, v, 0, NULL);
+        lacpd_lag_pool_dump(ds);
+        lacpd_status_writer_dump(ds, &st);
+        lacpd_delta_channel_dump(ds, &st);
+        lacpd_shards_dump(ds);
+        lacpd_stalls_dump(ds);
+        lacpd_link_watch_dump(ds);
+        lacpd_fast_tx_dump(ds, &st);
     }
+
+    view_put(v);
 } /* lacpd_debug_dump */
 
 /**
@@ -3329,86 +5228,67 @@ void
 lacpd_lag_ports_dump(struct ds *ds, int argc, const char *argv[])
 {
     struct shash_node *sh_node;
-    struct port_data *portp = NULL;
+    struct lacpd_view *v;
+    struct view_port *vp = NULL;
+
+    v = view_get();
+    if (v == NULL) {
+        return;
+    }
 
     if (argc > 1) { /* a lag is specified in argv */
-        portp = shash_find_data(&all_ports, argv[1]);
-        if (portp) {
-            if (!strncmp(portp->name, LAG_PORT_NAME_PREFIX, LAG_PORT_NAME_PREFIX_LENGTH)) {
-                ds_put_format(ds, "Port %s:\n", portp->name);
-                lacpd_lag_member_interfaces_dump(ds, portp);
+        vp = shash_find_data(&v->ports, argv[1]);
+        if (vp) {
+            if (!strncmp(vp->name, LAG_PORT_NAME_PREFIX, LAG_PORT_NAME_PREFIX_LENGTH)) {
+                ds_put_format(ds, "Port %s:\n", vp->name);
+                lacpd_lag_member_interfaces_dump(ds, vp);
             }
         }
     } else { /* dump all ports */
-        SHASH_FOR_EACH(sh_node, &all_ports) {
-            portp = sh_node->data;
-            if (portp) {
-                if (!strncmp(portp->name, LAG_PORT_NAME_PREFIX, LAG_PORT_NAME_PREFIX_LENGTH)) {
-                    ds_put_format(ds, "Port %s:\n", portp->name);
-                    lacpd_lag_member_interfaces_dump(ds, portp);
+        SHASH_FOR_EACH(sh_node, &v->ports) {
+            vp = sh_node->data;
+            if (vp) {
+                if (!strncmp(vp->name, LAG_PORT_NAME_PREFIX, LAG_PORT_NAME_PREFIX_LENGTH)) {
+                    ds_put_format(ds, "Port %s:\n", vp->name);
+                    lacpd_lag_member_interfaces_dump(ds, vp);
                 }
             }
         }
     }
+
+    view_put(v);
 } /* lacpd_dump_lag_interfaces */
 
 
 /**
  * @details
- * The idea of this code is to make the match between two structs:
- *   1. port_data which contains the port data of a LAG including the list of
- *      all the configured interfaces.
- *   2. lacp_per_port_variables_t which contains the pdu counters for each
- *      interface member of a lag.
- * We go through all the configured interfaces for the lag specified in the
- * parameter portp, and we look for an interface in lacp_per_port_vars_tree
- * with the same port number. Once we find it we print the pdu counters.
+ * Dumps the pdu counters of all the configured interfaces of the lag
+ * specified in the parameter vp.  The counters are read from the
+ * snapshot last published by the protocol shard running each interface,
+ * so the dump never blocks the state machines.
 */
-void lacpd_dump_pdus_per_interface(struct ds *ds, struct port_data *portp)
+void lacpd_dump_pdus_per_interface(struct ds *ds, const struct lacpd_view *v,
+                                   const struct view_port *vp)
 {
-    struct shash_node *node;
-    lacp_per_port_variables_t *lacp_port_variable;
-    int port_number_iface_data;
-    int port_number_lacp_port_variable;
+    const char *name;
+    size_t i;
+    lacp_port_snapshot_t snap;
 
     ds_put_format(ds, " Configured interfaces:\n");
 
     /*Go through all the configured interfaces*/
-    SHASH_FOR_EACH(node, &portp->cfg_member_ifs) {
-        struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            /* This port_id has this format "port_priority,port_id" and
-             * is formed using the function format_port_id defined in this file. */
-            const char* port_id_char = idp->actor.port_id;
-            int temp_port_priority;
-            sscanf(port_id_char, "%d,%d", &temp_port_priority, &port_number_iface_data);
-            /* The port_number is equal to the port_id minus one*/
-            port_number_iface_data--;
-
-            RENTRY();
-            /* Go through lacp_per_port_vars_tree looking for a
-             * lacp_per_port_variables_t corresponding to the port number we
-             * found before. */
-            lacp_port_variable = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-            while (lacp_port_variable) {
-
-                port_number_lacp_port_variable = PM_HANDLE2PORT(lacp_port_variable->lport_handle);
-
-                if (port_number_lacp_port_variable == port_number_iface_data) {
-                    ds_put_format(ds, "  Interface: %s\n", idp->name);
-                    ds_put_format(ds, "    lacp_pdus_sent: %d\n",
-                                  lacp_port_variable->lacp_pdus_sent);
-                    ds_put_format(ds, "    marker_response_pdus_sent: %d\n",
-                                  lacp_port_variable->marker_response_pdus_sent);
-                    ds_put_format(ds, "    lacp_pdus_received: %d\n",
-                                  lacp_port_variable->lacp_pdus_received);
-                    ds_put_format(ds, "    marker_pdus_received: %d\n",
-                                  lacp_port_variable->marker_pdus_received);
-                    break;
-                }
-                lacp_port_variable = LACP_AVL_NEXT(lacp_port_variable->avlnode);
-            }
-            REXIT();
+    SVEC_FOR_EACH(i, name, &vp->cfg_members) {
+        struct view_iface *vi = shash_find_data(&v->interfaces, name);
+        if (vi && LACP_read_port_snapshot(vi->index, &snap)) {
+            ds_put_format(ds, "  Interface: %s\n", vi->name);
+            ds_put_format(ds, "    lacp_pdus_sent: %d\n",
+                          snap.lacp_pdus_sent);
+            ds_put_format(ds, "    marker_response_pdus_sent: %d\n",
+                          snap.marker_response_pdus_sent);
+            ds_put_format(ds, "    lacp_pdus_received: %d\n",
+                          snap.lacp_pdus_received);
+            ds_put_format(ds, "    marker_pdus_received: %d\n",
+                          snap.marker_pdus_received);
         }
     }
 }/* lacpd_dump_pdus_per_interface */
@@ -3422,118 +5302,99 @@ void
 lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[])
 {
     struct shash_node *sh_node;
-    struct port_data *portp = NULL;
+    struct lacpd_view *v;
+    struct view_port *vp = NULL;
+
+    v = view_get();
+    if (v == NULL) {
+        return;
+    }
 
     if (argc > 1) { /* a lag is specified in argv */
-        portp = shash_find_data(&all_ports, argv[1]);
-        if (portp){
-            if (!strncmp(portp->name,
+        vp = shash_find_data(&v->ports, argv[1]);
+        if (vp){
+            if (!strncmp(vp->name,
                          LAG_PORT_NAME_PREFIX,
                          LAG_PORT_NAME_PREFIX_LENGTH)
-                && portp->lacp_mode != PORT_LACP_OFF) {
+                && vp->lacp_mode != PORT_LACP_OFF) {
 
-                ds_put_format(ds, "LAG %s:\n", portp->name);
-                lacpd_dump_pdus_per_interface(ds, portp);
+                ds_put_format(ds, "LAG %s:\n", vp->name);
+                lacpd_dump_pdus_per_interface(ds, v, vp);
             }
         }
     } else { /* dump all ports */
-        SHASH_FOR_EACH(sh_node, &all_ports) {
-            portp = sh_node->data;
-            if (portp) {
-                if (!strncmp(portp->name,
+        SHASH_FOR_EACH(sh_node, &v->ports) {
+            vp = sh_node->data;
+            if (vp) {
+                if (!strncmp(vp->name,
                              LAG_PORT_NAME_PREFIX,
                              LAG_PORT_NAME_PREFIX_LENGTH)
-                    && portp->lacp_mode != PORT_LACP_OFF) {
+                    && vp->lacp_mode != PORT_LACP_OFF) {
 
-                    ds_put_format(ds, "LAG %s:\n", portp->name);
-                    lacpd_dump_pdus_per_interface(ds, portp);
+                    ds_put_format(ds, "LAG %s:\n", vp->name);
+                    lacpd_dump_pdus_per_interface(ds, v, vp);
                 }
             }
         }
     }
+
+    view_put(v);
 }/* lacpd_pdus_counters_dump */
 
 /**
  * @details
- * The idea of this code is to make the match between two structs:
- *   1. port_data which contains the port data of a LAG including the list of
- *      all the configured interfaces.
- *   2. lacp_per_port_variables_t which contains lacpd state machine control
- *      variables and the state parameters for each interface member of a lag.
- * We go through all the configured interfaces for the lag specified in
- * the parameter portp, and we look for an interface in
- * lacp_per_port_vars_tree with the same port number. Once we find it we print
- * the lacpd state.
+ * Dumps the lacpd state machine control variables and the state parameters
+ * of all the configured interfaces of the lag specified in the parameter
+ * vp.  They are read from the snapshot last published by the protocol
+ * shard running each interface, so the dump never blocks the state
+ * machines and all values of an interface are from the same moment.
 */
-void lacpd_dump_state_per_interface(struct ds *ds, struct port_data *portp)
+void lacpd_dump_state_per_interface(struct ds *ds, const struct lacpd_view *v,
+                                    const struct view_port *vp)
 {
-    struct shash_node *node;
-    lacp_per_port_variables_t *lacp_port_variable;
-    struct iface_data *idp;
-    const char* port_id_char;
-    int port_number_iface_data;
-    int port_number_lacp_port_variable;
-    int temp_port_priority;
+    const char *name;
+    size_t i;
+    struct view_iface *vi;
+    lacp_port_snapshot_t snap;
 
     ds_put_format(ds, " Configured interfaces:\n");
 
     /* Go through all the configured interfaces */
-    SHASH_FOR_EACH(node, &portp->cfg_member_ifs) {
-        idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            /* This port_id has this format "port_priority,port_id" and
-             * is formed using the function format_port_id defined in this file. */
-            port_id_char = idp->actor.port_id;
-            sscanf(port_id_char, "%d,%d", &temp_port_priority, &port_number_iface_data);
-            /* The port_number is equal to the port_id minus one*/
-            port_number_iface_data--;
-
-            RENTRY();
-            /* Go through lacp_per_port_vars_tree looking for a lacp_per_port_variables_t
-             * corresponding to the port number we found before. */
-            lacp_port_variable = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-            while (lacp_port_variable) {
-
-                port_number_lacp_port_variable = PM_HANDLE2PORT(lacp_port_variable->lport_handle);
-
-                if (port_number_lacp_port_variable == port_number_iface_data) {
-                    ds_put_format(ds, "  Interface: %s\n", idp->name);
-
-                    ds_put_format(ds, "    actor_oper_port_state \n");
-                    ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
-                                    lacp_port_variable->actor_oper_port_state.lacp_activity,
-                                    lacp_port_variable->actor_oper_port_state.lacp_timeout,
-                                    lacp_port_variable->actor_oper_port_state.aggregation,
-                                    lacp_port_variable->actor_oper_port_state.synchronization,
-                                    lacp_port_variable->actor_oper_port_state.collecting,
-                                    lacp_port_variable->actor_oper_port_state.distributing,
-                                    lacp_port_variable->actor_oper_port_state.defaulted,
-                                    lacp_port_variable->actor_oper_port_state.expired);
-                    ds_put_format(ds, "    partner_oper_port_state \n");
-                    ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
-                                    lacp_port_variable->partner_oper_port_state.lacp_activity,
-                                    lacp_port_variable->partner_oper_port_state.lacp_timeout,
-                                    lacp_port_variable->partner_oper_port_state.aggregation,
-                                    lacp_port_variable->partner_oper_port_state.synchronization,
-                                    lacp_port_variable->partner_oper_port_state.collecting,
-                                    lacp_port_variable->partner_oper_port_state.distributing,
-                                    lacp_port_variable->partner_oper_port_state.defaulted,
-                                    lacp_port_variable->partner_oper_port_state.expired);
-                    ds_put_format(ds, "    lacp_control\n");
-                    ds_put_format(ds, "       begin:%d actor_churn:%d partner_churn:%d ready_n:%d selected:%d port_moved:%d ntt:%d port_enabled:%d\n",
-                                    lacp_port_variable->lacp_control.begin,
-                                    lacp_port_variable->lacp_control.actor_churn,
-                                    lacp_port_variable->lacp_control.partner_churn,
-                                    lacp_port_variable->lacp_control.ready_n,
-                                    lacp_port_variable->lacp_control.selected,
-                                    lacp_port_variable->lacp_control.port_moved,
-                                    lacp_port_variable->lacp_control.ntt,
-                                    lacp_port_variable->lacp_control.port_enabled);
-                    break;
-                }
-                lacp_port_variable = LACP_AVL_NEXT(lacp_port_variable->avlnode);
-            }
-            REXIT();
+    SVEC_FOR_EACH(i, name, &vp->cfg_members) {
+        vi = shash_find_data(&v->interfaces, name);
+        if (vi && LACP_read_port_snapshot(vi->index, &snap)) {
+            ds_put_format(ds, "  Interface: %s\n", vi->name);
+
+            ds_put_format(ds, "    actor_oper_port_state \n");
+            ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
+                            snap.actor_oper_port_state.lacp_activity,
+                            snap.actor_oper_port_state.lacp_timeout,
+                            snap.actor_oper_port_state.aggregation,
+                            snap.actor_oper_port_state.synchronization,
+                            snap.actor_oper_port_state.collecting,
+                            snap.actor_oper_port_state.distributing,
+                            snap.actor_oper_port_state.defaulted,
+                            snap.actor_oper_port_state.expired);
+            ds_put_format(ds, "    partner_oper_port_state \n");
+            ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
+                            snap.partner_oper_port_state.lacp_activity,
+                            snap.partner_oper_port_state.lacp_timeout,
+                            snap.partner_oper_port_state.aggregation,
+                            snap.partner_oper_port_state.synchronization,
+                            snap.partner_oper_port_state.collecting,
+                            snap.partner_oper_port_state.distributing,
+                            snap.partner_oper_port_state.defaulted,
+                            snap.partner_oper_port_state.expired);
+            ds_put_format(ds, "    lacp_control\n");
+            ds_put_format(ds, "       begin:%d actor_churn:%d partner_churn:%d ready_n:%d selected:%d port_moved:%d ntt:%d port_enabled:%d\n",
+                            snap.lacp_control.begin,
+                            snap.lacp_control.actor_churn,
+                            snap.lacp_control.partner_churn,
+                            snap.lacp_control.ready_n,
+                            snap.lacp_control.selected,
+                            snap.lacp_control.port_moved,
+                            snap.lacp_control.ntt,
+                            snap.lacp_control.port_enabled);
         }
     }
 }/* lacpd_dump_state_per_interface */
@@ -3547,35 +5408,43 @@ void
 lacpd_state_dump(struct ds *ds, int argc, const char *argv[])
 {
     struct shash_node *sh_node;
-    struct port_data *portp = NULL;
+    struct lacpd_view *v;
+    struct view_port *vp = NULL;
+
+    v = view_get();
+    if (v == NULL) {
+        return;
+    }
 
     if (argc > 1) { /* a lag is specified in argv */
-        portp = shash_find_data(&all_ports, argv[1]);
-        if (portp) {
-            if (!strncmp(portp->name,
+        vp = shash_find_data(&v->ports, argv[1]);
+        if (vp) {
+            if (!strncmp(vp->name,
                          LAG_PORT_NAME_PREFIX,
                          LAG_PORT_NAME_PREFIX_LENGTH)
-                && portp->lacp_mode != PORT_LACP_OFF) {
+                && vp->lacp_mode != PORT_LACP_OFF) {
 
-                ds_put_format(ds, "LAG %s:\n", portp->name);
-                lacpd_dump_state_per_interface(ds, portp);
+                ds_put_format(ds, "LAG %s:\n", vp->name);
+                lacpd_dump_state_per_interface(ds, v, vp);
             }
         }
     } else { /* dump all ports */
-        SHASH_FOR_EACH(sh_node, &all_ports) {
-            portp = sh_node->data;
-            if (portp) {
-                if (!strncmp(portp->name,
+        SHASH_FOR_EACH(sh_node, &v->ports) {
+            vp = sh_node->data;
+            if (vp) {
+                if (!strncmp(vp->name,
                              LAG_PORT_NAME_PREFIX,
                              LAG_PORT_NAME_PREFIX_LENGTH)
-                    && portp->lacp_mode != PORT_LACP_OFF) {
+                    && vp->lacp_mode != PORT_LACP_OFF) {
 
-                    ds_put_format(ds, "LAG %s:\n", portp->name);
-                    lacpd_dump_state_per_interface(ds, portp);
+                    ds_put_format(ds, "LAG %s:\n", vp->name);
+                    lacpd_dump_state_per_interface(ds, v, vp);
                 }
             }
         }
     }
+
+    view_put(v);
 }/* lacpd_state_dump */
 
 /**********************************************************************/
@@ -3596,10 +5465,44 @@ lacpd_exit(void)
  * lacpd daemon's main OVS interface function.  Repeat loop that
  * calls run, wait, poll_block, etc. functions for lacpd.
  *
+ * @param arg unused.
+ */
+void *
+lacpd_ovs_main_thread(void *arg OVS_UNUSED)
+{
+    /* Detach thread to avoid memory leak upon exit. */
+    pthread_detach(pthread_self());
+
+    while (!__atomic_load_n(&exiting, __ATOMIC_ACQUIRE)) {
+        lacpd_run();
+
+        lacpd_wait();
+        if (__atomic_load_n(&exiting, __ATOMIC_ACQUIRE)) {
+            poll_immediate_wake();
+        } else {
+            poll_block();
+        }
+    }
+
+    lacpd_exit();
+
+    /* OPS_TODO -- need to tell main loop to exit... */
+
+    return NULL;
+
+} /* lacpd_ovs_main_thread */
+
+/**
+ * @details
+ * Serves ovs-appctl requests.  The commands only read the views and
+ * snapshots published by the OVS and protocol threads, so a slow dump
+ * doesn't hold up configuration changes and a burst of configuration
+ * changes doesn't make appctl time out.
+ *
  * @param arg pointer to ovs-appctl server struct.
  */
 void *
-lacpd_ovs_main_thread(void *arg)
+lacpd_appctl_thread(void *arg)
 {
     struct unixctl_server *appctl;
 
@@ -3608,27 +5511,21 @@ lacpd_ovs_main_thread(void *arg)
 
     appctl = (struct unixctl_server *)arg;
 
-    exiting = false;
-    while (!exiting) {
-        lacpd_run();
+    while (!__atomic_load_n(&exiting, __ATOMIC_ACQUIRE)) {
         unixctl_server_run(appctl);
 
-        lacpd_wait();
         unixctl_server_wait(appctl);
-        if (exiting) {
+        if (__atomic_load_n(&exiting, __ATOMIC_ACQUIRE)) {
             poll_immediate_wake();
         } else {
             poll_block();
         }
     }
 
-    lacpd_exit();
     unixctl_server_destroy(appctl);
 
-    /* OPS_TODO -- need to tell main loop to exit... */
-
     return NULL;
 
-} /* lacpd_ovs_main_thread */
+} /* lacpd_appctl_thread */
 
 /**@} end of lacpd group */
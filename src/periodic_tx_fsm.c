@@ -214,7 +214,7 @@ LACP_periodic_tx_fsm(int event,
         break;
     }
 
-    db_update_interface(plpinfo);
+    LACP_effect_status(plpinfo);
 
     REXIT();
 } // LACP_periodic_tx_fsm
@@ -217,7 +217,10 @@ LACP_receive_fsm(int event, int current_state,
                  action, plpinfo->lport_handle);
         }
 
-        plpinfo->recv_fsm_state = current_state;
+        if (plpinfo->recv_fsm_state != current_state) {
+            plpinfo->recv_fsm_state = current_state;
+            LACP_update_sport_priority(plpinfo);
+        }
 
     } else {
         if (plpinfo->debug_level & DBG_RX_FSM) {
@@ -285,7 +288,7 @@ LACP_receive_fsm(int event, int current_state,
         break;
     }
 
-    db_update_interface(plpinfo);
+    LACP_effect_status(plpinfo);
 
     REXIT();
 
@@ -605,16 +608,12 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
         status = mvlan_get_sport(plpinfo->sport_handle , &psport,
                                          MLm_vpm_api__get_sport);
         if (R_SUCCESS == status) {
-            plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-            while (plpinfo_priority) {
-                if (plpinfo_priority->lport_handle != plpinfo->lport_handle &&
-                    plpinfo_priority->sport_handle == psport->handle &&
+            SPORT_FOR_EACH_LPORT(plpinfo_priority, psport) {
+                if (plpinfo_priority != plpinfo &&
                     plpinfo_priority->partner_oper_port_priority != 0 &&
                     max_port_priority > plpinfo_priority->partner_oper_port_priority) {
                     max_port_priority = plpinfo_priority->partner_oper_port_priority;
                 }
-                plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
             }
 
             placp_sport_params = psport->placp_params;
@@ -1445,31 +1444,22 @@ format_state(state_parameters_t state, char *result)
 static void
 update_max_port_priority(lacp_per_port_variables_t *plpinfo)
 {
-    super_port_t *psport;
+    super_port_t *psport = plpinfo->sport_member.psport;
     lacp_int_sport_params_t *placp_sport_params;
-    int status = R_SUCCESS;
     int max_port_priority = MAX_PORT_PRIORITY;
-    lacp_per_port_variables_t *plpinfo_priority;
     struct MLt_vpm_api__lacp_sport_params pmsg;
     int current_port_priority;
 
-    status = mvlan_get_sport(plpinfo->sport_handle, &psport,
-                             MLm_vpm_api__get_sport);
-
-    if (R_SUCCESS == status) {
+    // The super port of plpinfo->sport_handle, if it exists.
+    if (psport != NULL && psport->placp_params != NULL) {
         placp_sport_params = psport->placp_params;
-        plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
         current_port_priority = placp_sport_params->lacp_params.actor_max_port_priority;
 
-        while (plpinfo_priority) {
-            if (plpinfo_priority->sport_handle == psport->handle &&
-                plpinfo_priority->recv_fsm_state != RECV_FSM_DEFAULTED_STATE &&
-                max_port_priority > plpinfo_priority->actor_oper_port_priority) {
-
-                max_port_priority = plpinfo_priority->actor_oper_port_priority;
-            }
-            plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
+        // The priority list is sorted, its head has the max priority.
+        if (psport->pprio_list != NULL) {
+            max_port_priority = psport->pprio_list->actor_oper_port_priority;
         }
+
         // If max_port_priority changed, we need to reselect all interfaces
         if (current_port_priority != max_port_priority) {
             placp_sport_params->lacp_params.actor_max_port_priority = max_port_priority;
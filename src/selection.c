@@ -40,18 +40,44 @@
 VLOG_DEFINE_THIS_MODULE(selection);
 
 //*************************************************************
-// List of LAGs for ease & debug.
+// Active LAGs of this protocol shard, hashed on LAG ID and port
+// type.  Chained through LAG_t.hash_next; the number of buckets
+// must be a power of 2.
 //*************************************************************
-struct NList *mlacp_lag_tuple_list;
+#define LAG_ID_HASH_SIZE    256
 
-extern int lacp_lag_port_match(void *, void *);
+static __thread LAG_t *lag_id_hash[LAG_ID_HASH_SIZE];
+
+//*************************************************************
+// LAGs are allocated from a fixed pool.  A port is a member of
+// at most one LAG, so one entry per possible lport is enough.
+// Each entry carries the LAG's LAG_Id with it.  Freed LAGs are
+// chained through hash_next; entries never handed out yet are
+// taken from lag_pool_next_unused on, so unused entries are
+// never touched.  Each shard allocates its own pool when its
+// thread starts, see LAG_pool_init().  The usage counters are
+// kept per shard, with atomic accesses, so the OVS thread can
+// report them.
+//*************************************************************
+#define LAG_POOL_SIZE   PM_MAX_PORTS
+
+typedef struct lag_pool_entry {
+    LAG_t lag;
+    LAG_Id_t lag_id;
+} lag_pool_entry_t;
+
+static __thread lag_pool_entry_t *lag_pool = NULL;
+static __thread LAG_t *lag_pool_free_list = NULL;
+static __thread int lag_pool_next_unused = 0;
+static int lag_pool_in_use[ML_MAX_SHARDS];
+static int lag_pool_high_water[ML_MAX_SHARDS];
 
 /*****************************************************************************
  *          Prototypes for static functions
  ****************************************************************************/
-static LAG_Id_t *form_lag_id(lacp_per_port_variables_t *);
+static void form_lag_id(lacp_per_port_variables_t *, LAG_Id_t *);
 static int compare_lag_id (LAG_Id_t *, LAG_Id_t *);
-static int is_port_partner_port(port_handle_t, LAG_t *const);
+static int is_port_partner_port(lacp_per_port_variables_t *, LAG_t *const);
 static void LAG_select_aggregator(LAG_t *const, lacp_per_port_variables_t *);
 static void print_lag_id(LAG_Id_t *lag_id);
 
@@ -121,16 +147,235 @@ compare_lag_id(LAG_Id_t *first_lag_id, LAG_Id_t *second_lag_id)
     return TRUE;
 } // compare_lag_id
 
-int
-compare_port_handle(void* lag_port_struct1, void* lag_port_struct2)
+//******************************************************************
+// Function : lag_id_hash_bucket
+//******************************************************************
+static unsigned int
+lag_id_hash_bucket(LAG_Id_t *lag_id, enum PM_lport_type port_type)
+{
+    const unsigned int fields[] = {
+        lag_id->local_system_priority,
+        (lag_id->local_system_mac_addr[0] << 16) ^
+            (lag_id->local_system_mac_addr[1] << 8) ^
+            lag_id->local_system_mac_addr[2],
+        lag_id->local_port_key,
+        lag_id->local_port_priority,
+        lag_id->local_port_number,
+        lag_id->remote_system_priority,
+        (lag_id->remote_system_mac_addr[0] << 16) ^
+            (lag_id->remote_system_mac_addr[1] << 8) ^
+            lag_id->remote_system_mac_addr[2],
+        lag_id->remote_port_key,
+        lag_id->remote_port_priority,
+        lag_id->remote_port_number,
+        lag_id->fallback,
+        port_type,
+    };
+    unsigned int hash = 2166136261u;
+    unsigned int i;
+
+    // FNV-1a, one field at a time.
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        hash = (hash ^ fields[i]) * 16777619u;
+    }
+
+    return (hash ^ (hash >> 16)) & (LAG_ID_HASH_SIZE - 1);
+} // lag_id_hash_bucket
+
+//******************************************************************
+// Function : LAG_pool_init
+//******************************************************************
+// Allocates the calling shard's pool, before it handles any event.
+// If that fails, LAG_alloc() fails as if the pool were exhausted.
+void
+LAG_pool_init(void)
+{
+    lag_pool = calloc(LAG_POOL_SIZE, sizeof(*lag_pool));
+    if (lag_pool == NULL) {
+        VLOG_ERR("%s: out of memory for the LAG pool of shard %d",
+                 __FUNCTION__, ml_shard_id);
+    }
+} // LAG_pool_init
+
+//******************************************************************
+// Function : LAG_alloc
+//******************************************************************
+// Returns a LAG from the pool with LAG_Id set, or NULL if the pool
+// is exhausted.
+static LAG_t *
+LAG_alloc(void)
+{
+    LAG_t *lag;
+    int in_use;
+
+    if (lag_pool_free_list != NULL) {
+        lag = lag_pool_free_list;
+        lag_pool_free_list = lag->hash_next;
+    } else if (lag_pool != NULL && lag_pool_next_unused < LAG_POOL_SIZE) {
+        lag_pool_entry_t *entry = &lag_pool[lag_pool_next_unused++];
+
+        lag = &entry->lag;
+        lag->LAG_Id = &entry->lag_id;
+    } else {
+        return NULL;
+    }
+
+    // Only this shard writes its counters.
+    in_use = lag_pool_in_use[ml_shard_id] + 1;
+    __atomic_store_n(&lag_pool_in_use[ml_shard_id], in_use, __ATOMIC_RELAXED);
+    if (in_use > lag_pool_high_water[ml_shard_id]) {
+        __atomic_store_n(&lag_pool_high_water[ml_shard_id], in_use,
+                         __ATOMIC_RELAXED);
+    }
+
+    return lag;
+} // LAG_alloc
+
+//******************************************************************
+// Function : LAG_free
+//******************************************************************
+static void
+LAG_free(LAG_t *lag)
+{
+    lag->hash_next = lag_pool_free_list;
+    lag_pool_free_list = lag;
+    __atomic_store_n(&lag_pool_in_use[ml_shard_id],
+                     lag_pool_in_use[ml_shard_id] - 1, __ATOMIC_RELAXED);
+} // LAG_free
+
+//******************************************************************
+// Function : LAG_pool_stats
+//******************************************************************
+// Usage of one shard's pool.  Called from the OVS and appctl
+// threads.
+void
+LAG_pool_stats(int shard, int *size, int *in_use, int *high_water)
+{
+    *size = LAG_POOL_SIZE;
+    *in_use = __atomic_load_n(&lag_pool_in_use[shard], __ATOMIC_RELAXED);
+    *high_water = __atomic_load_n(&lag_pool_high_water[shard],
+                                  __ATOMIC_RELAXED);
+} // LAG_pool_stats
+
+//******************************************************************
+// Function : LAG_find
+//******************************************************************
+// Returns the active LAG with the given LAG ID and port type, or NULL.
+static LAG_t *
+LAG_find(LAG_Id_t *lag_id, enum PM_lport_type port_type)
+{
+    LAG_t *lag;
+
+    for (lag = lag_id_hash[lag_id_hash_bucket(lag_id, port_type)];
+         lag;
+         lag = lag->hash_next) {
+        if (lag->port_type == port_type &&
+            compare_lag_id(lag->LAG_Id, lag_id) == TRUE) {
+            return lag;
+        }
+    }
+
+    return NULL;
+} // LAG_find
+
+//******************************************************************
+// Function : LAG_delete
+//******************************************************************
+// Releases a LAG whose last member port has left.  The LAG is
+// unhashed and its super port parameters are cleared for reuse.
+void
+LAG_delete(LAG_t *lag)
+{
+    LAG_t **pprev;
+
+    if (lag->sp_handle != 0) {
+        mlacp_blocking_send_clear_aggregator(lag->sp_handle);
+    }
+
+    pprev = &lag_id_hash[lag_id_hash_bucket(lag->LAG_Id, lag->port_type)];
+    while (*pprev && *pprev != lag) {
+        pprev = &(*pprev)->hash_next;
+    }
+
+    if (*pprev) {
+        *pprev = lag->hash_next;
+    } else {
+        VLOG_ERR("%s : LAG not found in LAG ID hash", __FUNCTION__);
+    }
+
+    LAG_free(lag);
+
+} // LAG_delete
+
+//******************************************************************
+// Function : LAG_add_member
+//******************************************************************
+// Links the port into the LAG's port list, keeping the list sorted
+// by lport_handle.
+void
+LAG_add_member(LAG_t *lag, lacp_per_port_variables_t *plpinfo)
 {
-    if (((lacp_lag_ppstruct_t *)lag_port_struct1)->lport_handle >
-        ((lacp_lag_ppstruct_t *)lag_port_struct2)->lport_handle) {
-        return 1;
+    lacp_per_port_variables_t *prev = NULL;
+    lacp_per_port_variables_t *next;
+
+    if (plpinfo->lag_member.lag != NULL) {
+        VLOG_ERR("%s : lport 0x%llx is already a LAG member",
+                 __FUNCTION__, plpinfo->lport_handle);
+        return;
+    }
+
+    for (next = lag->members; next; next = next->lag_member.next) {
+        if (next->lport_handle > plpinfo->lport_handle) {
+            break;
+        }
+        prev = next;
+    }
+
+    plpinfo->lag_member.prev = prev;
+    plpinfo->lag_member.next = next;
+    plpinfo->lag_member.lag = lag;
+
+    if (prev) {
+        prev->lag_member.next = plpinfo;
     } else {
-        return -1;
+        lag->members = plpinfo;
+    }
+
+    if (next) {
+        next->lag_member.prev = plpinfo;
     }
-} // compare_port_handle
+
+    lag->num_members++;
+
+} // LAG_add_member
+
+//******************************************************************
+// Function : LAG_remove_member
+//******************************************************************
+void
+LAG_remove_member(LAG_t *lag, lacp_per_port_variables_t *plpinfo)
+{
+    if (!LAG_IS_MEMBER(lag, plpinfo)) {
+        return;
+    }
+
+    if (plpinfo->lag_member.prev) {
+        plpinfo->lag_member.prev->lag_member.next = plpinfo->lag_member.next;
+    } else {
+        lag->members = plpinfo->lag_member.next;
+    }
+
+    if (plpinfo->lag_member.next) {
+        plpinfo->lag_member.next->lag_member.prev = plpinfo->lag_member.prev;
+    }
+
+    plpinfo->lag_member.next = NULL;
+    plpinfo->lag_member.prev = NULL;
+    plpinfo->lag_member.lag = NULL;
+
+    lag->num_members--;
+
+} // LAG_remove_member
 
 //******************************************************************
 // Function : LAG_selection
@@ -139,11 +384,10 @@ void
 LAG_selection(lacp_per_port_variables_t *lacp_port)
 {
     int lock;
-    LAG_Id_t *lagId;
+    LAG_Id_t lagId;
     LAG_t *lag;
     lacp_per_port_variables_t *plp;
-    lacp_lag_ppstruct_t *plag_port_struct = NULL;
-    struct NList *pdummy;
+    unsigned int bucket;
 
     RENTRY();
 
@@ -161,16 +405,10 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     lock = lacp_lock();
     lacp_port->selecting_lag = TRUE;
 
-    lagId = form_lag_id(lacp_port);
-
-    if (lagId == NULL) {
-        lacp_port->selecting_lag = FALSE;
-        lacp_unlock(lock);
-        return;
-    }
+    form_lag_id(lacp_port, &lagId);
 
     if (lacp_port->debug_level & DBG_SELECT) {
-        print_lag_id(lagId);
+        print_lag_id(&lagId);
     }
 
     // lagId contains the admin and op keys for both the actor and partner
@@ -186,42 +424,18 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                  lacp_port->lport_handle);
         }
 
-        for (plp = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-             plp;
-             plp = LACP_AVL_NEXT(plp->avlnode))
-        {
-            if (!plp->lag) {
-                continue;
-            }
-
-            if (plp->lag->port_type != lacp_port->port_type) {
-                continue;
-            }
-
-            if (lacp_port->debug_level & DBG_SELECT) {
-                print_lag_id(plp->lag->LAG_Id);
-            }
-
-            // OpenSwitch: if partner info has not been received, treat it
-            //        as no match.  We need this since we're automating
-            //        LACP management.  We'll always try to LAG up if
-            //        possible, but if far end doesn't run LACP, we
-            //        cannot allow the two to LAG up; otherwise, it
-            //        results in a LAG being created on our end, but
-            //        two separate ports on the far end, causing loss
-            //        of traffic.
-            if (0 == memcmp(plp->partner_oper_system_variables.system_mac_addr,
-                            default_partner_system_mac,
-                            MAC_ADDR_LENGTH)) {
-                continue;
-            }
-
-            if (compare_lag_id(plp->lag->LAG_Id, lagId) == FALSE) {
-                continue;
-            }
-
-            lag = plp->lag;
-            break;
+        // OpenSwitch: if partner info has not been received, treat it
+        //        as no match.  We need this since we're automating
+        //        LACP management.  We'll always try to LAG up if
+        //        possible, but if far end doesn't run LACP, we
+        //        cannot allow the two to LAG up; otherwise, it
+        //        results in a LAG being created on our end, but
+        //        two separate ports on the far end, causing loss
+        //        of traffic.
+        if (memcmp(lagId.remote_system_mac_addr,
+                   default_partner_system_mac,
+                   MAC_ADDR_LENGTH) != 0) {
+            lag = LAG_find(&lagId, lacp_port->port_type);
         }
 
         /*2*/
@@ -229,15 +443,16 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
             // No LAG found with the same LAG id.  Could be the first
             // port to join a new LAG or the only (individual) port
             // to form an individual LAG.
-            if ((lag = (LAG_t *)malloc(sizeof(LAG_t))) == NULL) {
-                free(lagId);
-                VLOG_FATAL("%s : out of memory", __FUNCTION__);
+            // If the pool is exhausted the port stays unselected
+            // and selection is retried on its next event.
+            if ((lag = LAG_alloc()) == NULL) {
+                VLOG_ERR("%s : LAG pool exhausted (lport 0x%llx)",
+                         __FUNCTION__, lacp_port->lport_handle);
                 lacp_port->selecting_lag = FALSE;
                 lacp_unlock(lock);
-                exit(-1);
                 return;
             }
-            memset(lag, 0, sizeof(LAG_t));
+            memcpy(lag->LAG_Id, &lagId, sizeof(LAG_Id_t));
 
             if (lacp_port->debug_level & DBG_SELECT) {
                 RDBG("%s : no LAG found; create new LAG (lport 0x%llx)\n",
@@ -245,31 +460,28 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
             }
 
             lag->port_type = lacp_port->port_type;
-            lag->LAG_Id = lagId;
+            lag->ready = 0;
             lag->loop_back = loop_back_check(lacp_port) ? TRUE : FALSE;
+            lag->members = NULL;
+            lag->num_members = 0;
+            lag->sp_handle = 0;
 
-            plag_port_struct = calloc(1, sizeof(lacp_lag_ppstruct_t));
-            if (plag_port_struct == NULL) {
-                VLOG_FATAL("%s : out of memory", __FUNCTION__);
-                exit(-1);
-            }
-            plag_port_struct->lport_handle = lacp_port->lport_handle;
-            lag->pplist = n_list_insert_sorted(lag->pplist,
-                                               (void *)plag_port_struct,
-                                               compare_port_handle);
+            LAG_add_member(lag, lacp_port);
             lacp_port->lag = lag;
 
             //*************************************************************
-            // Insert this LAG into the list.
+            // Insert this LAG into the LAG ID hash.
             //*************************************************************
-            mlacp_lag_tuple_list = n_list_append(mlacp_lag_tuple_list, lag);
+            bucket = lag_id_hash_bucket(lag->LAG_Id, lag->port_type);
+            lag->hash_next = lag_id_hash[bucket];
+            lag_id_hash[bucket] = lag;
 
             //*************************************************************
             // Done.
             //*************************************************************
             if (lacp_port->debug_level & DBG_SELECT) {
                 char lag_id_str[LAG_ID_STRING_SIZE];
-                LAG_id_string(lag_id_str, lagId);
+                LAG_id_string(lag_id_str, lag->LAG_Id);
                 RDBG("%s : Port Added (%llx) to new LAG, ID string = %s",
                      __FUNCTION__, lacp_port->lport_handle, lag_id_str);
             }
@@ -288,28 +500,18 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                  lacp_port->lport_handle);
         }
 
-        if (n_list_find_data(lag->pplist,
-                             &lacp_lag_port_match,
-                             &lacp_port->lport_handle) == NULL) {
+        if (!LAG_IS_MEMBER(lag, lacp_port)) {
 
              // Add the port to the LAG, only if this port is not
              // a loop back and not a partner port to any of the
              // ports in the LAG and aggregatable on both the actor
              // and partner sides.
             if ((lag->loop_back = loop_back_check(lacp_port)) == FALSE &&
-                is_port_partner_port(lacp_port->lport_handle, lag) == 0 &&
+                is_port_partner_port(lacp_port, lag) == 0 &&
                 lacp_port->actor_oper_port_state.aggregation == AGGREGATABLE &&
                 lacp_port->partner_oper_port_state.aggregation == AGGREGATABLE) {
 
-                plag_port_struct = calloc(1, sizeof(lacp_lag_ppstruct_t));
-                if (plag_port_struct == NULL) {
-                    VLOG_FATAL("%s : out of memory", __FUNCTION__);
-                    exit(-1);
-                }
-                plag_port_struct->lport_handle = lacp_port->lport_handle;
-                lag->pplist = n_list_insert_sorted(lag->pplist,
-                                                   (void *)plag_port_struct,
-                                                   compare_port_handle);
+                LAG_add_member(lag, lacp_port);
                 lacp_port->lag = lag;
                 if (lacp_port->debug_level & DBG_SELECT) {
                     RDBG("%s : Port (0x%llx) Added to Existing LAG\n",
@@ -319,7 +521,6 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                 LAG_select_aggregator(lag, lacp_port);
             }
 
-            free(lagId);
             lacp_port->selecting_lag = FALSE;
             lacp_unlock(lock);
             return;
@@ -349,16 +550,9 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     // removed and the super port cleaned allowing the interface to attach to a
     // default partner
 
-    pdummy = n_list_find_data(lag->pplist,
-                              &lacp_lag_port_match,
-                              &lacp_port->lport_handle);
-    if (pdummy != NULL) {
-        plag_port_struct = pdummy->data;
-    }
-
-    if (plag_port_struct &&
+    if (LAG_IS_MEMBER(lag, lacp_port) &&
         (((lag->loop_back = loop_back_check(lacp_port)) == TRUE) ||
-         (compare_lag_id(lag->LAG_Id, lagId) == FALSE) ||
+         (compare_lag_id(lag->LAG_Id, &lagId) == FALSE) ||
          (lag->port_type != lacp_port->port_type))) {
 
         // Make selected UNSELECTED, and cause approp. event in
@@ -369,40 +563,29 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                      lacp_port);
 
         lacp_port->lacp_control.ready_n = FALSE;
-        lag->pplist =  n_list_remove_data(lag->pplist, plag_port_struct);
+        LAG_remove_member(lag, lacp_port);
 
         if (lacp_port->debug_level & DBG_SELECT) {
             RDBG("%s : Port (0x%llx) Removed from current LAG\n",
                  __FUNCTION__, lacp_port->lport_handle);
         }
 
-        if (lag->pplist == NULL) {
+        if (lag->num_members == 0) {
             // It was the last port in the LAG, remove the whole LAG.
-
-            // OpenSwitch: clear out sport params so it can be reused later.
-            if (lag->sp_handle != 0) {
-                mlacp_blocking_send_clear_aggregator(lag->sp_handle);
-            }
-
+            // OpenSwitch: this also clears out the sport params so
+            // they can be reused later.
             lacp_port->lag = NULL;
-            free(lag->LAG_Id);
-
-            // Remove the LAG from the tuple_list before we free it.
-            mlacp_lag_tuple_list = n_list_remove_data(mlacp_lag_tuple_list,
-                                                      lag);
-            free(lag);
+            LAG_delete(lag);
 
         } else if (lacp_port->debug_level & DBG_SELECT) {
             // --- OpenSwitch: DEBUG ONLY ---
-            lacp_lag_ppstruct_t *ptmp;
             RDBG("LAG.%d not empty:  ", (int)PM_HANDLE2LAG(lag->sp_handle));
-            N_LIST_FOREACH(lag->pplist, ptmp) {
-                RDBG("      0x%llx", ptmp->lport_handle);
-            } N_LIST_FOREACH_END(lag->pplist, ptmp);
+            LAG_FOR_EACH_MEMBER(plp, lag) {
+                RDBG("      0x%llx", plp->lport_handle);
+            }
         }
 
         lacp_port->lag = NULL;
-        free(lagId);
         lacp_port->selecting_lag = FALSE;
         lacp_unlock(lock);
 
@@ -418,7 +601,6 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     }
 
     // All is well and no change is required.
-    free(lagId);
 
     // Port is already in a LAG.  Select an aggregator
     // if one exists with the same keys.
@@ -470,26 +652,18 @@ LAG_select_aggregator(LAG_t *const lag, lacp_per_port_variables_t *lacp_port)
 //**************************************************************
 // Returns 1 if port is a partner port in LAG, 0 otherwise.
 static int
-is_port_partner_port(port_handle_t lport_handle, LAG_t *const lag)
+is_port_partner_port(lacp_per_port_variables_t *lacp_port, LAG_t *const lag)
 {
     lacp_per_port_variables_t *plpinfo;
 
-    RDEBUG(DL_SELECT, "%s : lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
+    RDEBUG(DL_SELECT, "%s : lport_handle 0x%llx\n", __FUNCTION__,
+           lacp_port->lport_handle);
 
-    if (!lag || lag->pplist == NULL) {
+    if (!lag || lag->num_members == 0 || !LAG_IS_MEMBER(lag, lacp_port)) {
         return 0;
     }
 
-    for (plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-         plpinfo;
-         plpinfo = LACP_AVL_NEXT(plpinfo->avlnode)) {
-        if (n_list_find_data(lag->pplist,
-                             &lacp_lag_port_match,
-                             &lport_handle) == NULL)
-        {
-            continue;
-        }
-
+    LAG_FOR_EACH_MEMBER(plpinfo, lag) {
         if (plpinfo->partner_oper_port_number == plpinfo->actor_admin_port_number) {
              return 1;
         }
@@ -527,19 +701,11 @@ loop_back_check(lacp_per_port_variables_t *plpinfo)
 //**************************************************************
 // Function : form_lag_id
 //**************************************************************
-static LAG_Id_t *
-form_lag_id(lacp_per_port_variables_t *lacp_port)
+static void
+form_lag_id(lacp_per_port_variables_t *lacp_port, LAG_Id_t *lagId)
 {
-    LAG_Id_t *lagId;
-
     RENTRY();
 
-    // Allocate memory for LAG ID.
-    if (!(lagId = (LAG_Id_t *)malloc(sizeof(LAG_Id_t)))) {
-        VLOG_FATAL("out of memory");
-        return NULL;
-    }
-
     // Zero out the LAG ID.
     memset(lagId, 0, sizeof(LAG_Id_t));
 
@@ -578,8 +744,6 @@ form_lag_id(lacp_per_port_variables_t *lacp_port)
     lagId->fallback = lacp_port->fallback_enabled;
 
     REXIT();
-
-    return (lagId);
 } // form_lag_id
 
 //************************************************************